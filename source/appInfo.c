@@ -1,10 +1,58 @@
 #include "appInfo.h"
 #include "graphics.h"
 
+#define QUEUE_SIZE  32 // power of 2
+
 static bool autoUpdate = false;
 static bool showBackground = true;
 extern appInfoObject_t  *appTop;
 
+typedef enum
+{
+    QUEUE_ADD,
+    QUEUE_REMOVE,
+    QUEUE_CLEAR
+}               queueOp_t;
+
+typedef struct  queueMessage_s
+{
+    appInfoObject_t *object;
+    u32             op;
+    u32             color;
+    u32             flags;
+    char            buffer[BUFFER_SIZE];
+}               queueMessage_t;
+
+// Entries added from another thread (the boot thread) are handed to the
+// main thread through this single producer, single consumer ring
+static queueMessage_t   queue[QUEUE_SIZE];
+static u32              queueHead = 0; // written by the main thread only
+static u32              queueTail = 0; // written by the producer only
+
+static inline bool  isMainThread(void)
+{
+    return (threadGetCurrent() == NULL);
+}
+
+static void queueMessage(appInfoObject_t *object, u32 op, u32 color, u32 flags, const char *text)
+{
+    queueMessage_t  *msg;
+
+    // Wait for the main thread to make room, it drains the ring while it
+    // joins the producer too
+    while (queueTail - __atomic_load_n(&queueHead, __ATOMIC_ACQUIRE) >= QUEUE_SIZE)
+        svcSleepThread(1000000);
+    msg = &queue[queueTail % QUEUE_SIZE];
+    msg->object = object;
+    msg->op = op;
+    msg->color = color;
+    msg->flags = flags;
+    if (text)
+        strncpy(msg->buffer, text, BUFFER_SIZE - 1);
+    msg->buffer[BUFFER_SIZE - 1] = '\0';
+    __atomic_store_n(&queueTail, queueTail + 1, __ATOMIC_RELEASE);
+}
+
 void    appInfoDisableAutoUpdate(void)
 {
     autoUpdate = false;
@@ -97,14 +145,12 @@ exit:
     return;
 }
 
-void newAppInfoEntry(appInfoObject_t *object, u32 color, u32 flags, char *text, ...)
+static void addEntry(appInfoObject_t *object, u32 color, u32 flags, const char *text)
 {
     u32             entryCount;
     u32             *entryList;
     appInfoEntry_t  *entry;
-    va_list         vaList;
 
-    if (!text || !object) goto exit;
     if (flags & SCROLL)
     {
         scrollDown(object);
@@ -119,14 +165,29 @@ void newAppInfoEntry(appInfoObject_t *object, u32 color, u32 flags, char *text,
         entryCount = object->entryCount;
     }
     entry = (appInfoEntry_t *)calloc(1, sizeof(appInfoEntry_t));
-    if (!entry) goto exit;
-    va_start(vaList, text);
-    vsnprintf(entry->buffer, BUFFER_SIZE, text, vaList);
-    va_end(vaList);
+    if (!entry) return;
+    strncpy(entry->buffer, text, BUFFER_SIZE - 1);
     entry->color = color;
     entry->flags = flags;
     entryList[entryCount] = (u32)entry;
     object->entryCount++;
+}
+
+void newAppInfoEntry(appInfoObject_t *object, u32 color, u32 flags, char *text, ...)
+{
+    char            buffer[BUFFER_SIZE];
+    va_list         vaList;
+
+    if (!text || !object) goto exit;
+    va_start(vaList, text);
+    vsnprintf(buffer, BUFFER_SIZE, text, vaList);
+    va_end(vaList);
+    if (!isMainThread())
+    {
+        queueMessage(object, QUEUE_ADD, color, flags, buffer);
+        goto exit;
+    }
+    addEntry(object, color, flags, buffer);
     if (autoUpdate)
         updateUI();
 exit:
@@ -153,6 +214,11 @@ exit:
 
 void    removeAppInfoEntry(appInfoObject_t *object)
 {
+    if (!isMainThread())
+    {
+        queueMessage(object, QUEUE_REMOVE, 0, 0, NULL);
+        return;
+    }
     deleteLastEntry(object);
     if (autoUpdate)
         updateUI();
@@ -163,6 +229,11 @@ void    clearAppInfo(appInfoObject_t *object, bool updateScreen)
     u32     entryCount;
     int     i;
 
+    if (!isMainThread())
+    {
+        queueMessage(object, QUEUE_CLEAR, 0, 0, NULL);
+        return;
+    }
     entryCount = object->entryCount;
     for (i = entryCount; i > 0; i--)
         deleteLastEntry(object);
@@ -170,6 +241,28 @@ void    clearAppInfo(appInfoObject_t *object, bool updateScreen)
         updateUI();
 }
 
+// Main thread: apply what the other threads queued, called by updateUI
+void    appInfoFlushQueue(void)
+{
+    queueMessage_t  *msg;
+    u32             tail;
+    int             i;
+
+    tail = __atomic_load_n(&queueTail, __ATOMIC_ACQUIRE);
+    while (queueHead != tail)
+    {
+        msg = &queue[queueHead % QUEUE_SIZE];
+        if (msg->op == QUEUE_ADD)
+            addEntry(msg->object, msg->color, msg->flags, msg->buffer);
+        else if (msg->op == QUEUE_REMOVE)
+            deleteLastEntry(msg->object);
+        else
+            for (i = msg->object->entryCount; i > 0; i--)
+                deleteLastEntry(msg->object);
+        __atomic_store_n(&queueHead, queueHead + 1, __ATOMIC_RELEASE);
+    }
+}
+
 void drawMultilineText(u32 color, u32 flags, char* txt) {
     float textWidth;
     float totalWidth = appTop->boundX - appTop->cursor.posX;
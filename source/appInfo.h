@@ -57,6 +57,7 @@ void                appInfoDisableAutoUpdate(void);
 void                appInfoEnableAutoUpdate(void);
 void                appInfoHideBackground(void);
 void                appInfoShowBackground(void);
+void                appInfoFlushQueue(void);
 /*
 ** graphic.h
 */
@@ -1,19 +1,26 @@
 #include "main.h"
+#include "csvc.h"
 
-extern u8       *tmpBuffer;
 extern char     *g_primary_error;
 extern char     *g_secondary_error;
 
-void    wait_keys_clear(void)
+// Sleep until HID publishes a pad state with no key down, held or released
+static void waitNoKeys(void)
 {
     while (1)
     {
         hidScanInput();
         if ((hidKeysDown() | hidKeysUp() | hidKeysHeld()) == 0)
             break;
+        hidWaitForEvent(HIDEVENT_PAD0, true);
     }
 }
 
+void    wait_keys_clear(void)
+{
+    waitNoKeys();
+}
+
 bool    abort_and_exit(void)
 {
     hidScanInput();
@@ -43,26 +50,12 @@ u32     getCurrentProcessHandle(void)
     return (hCurrentProcess);
 }
 
-void    flushDataCache(void)
-{
-    u32 *ptr = (u32 *)tmpBuffer;
-    u32 i;
-
-    for (i = 0; i < (0x20000 / 4); i++)
-    {
-        ptr[i] += 0x11111111;
-    }
-}
-
+// Whole cache maintenance, only for the handoff to NTR: every core is
+// stalled while it runs
 void    doFlushCache(void)
 {
-    FlushAllCache();
-    InvalidateEntireInstructionCache();
-    InvalidateEntireDataCache();
-    flushDataCache();
-    FlushAllCache();
-    InvalidateEntireInstructionCache();
-    InvalidateEntireDataCache();
+    svcFlushEntireDataCache();
+    svcInvalidateEntireInstructionCache();
 }
 
 void doStallCpu(void)
@@ -136,28 +129,29 @@ bool    inputPathKeyboard(char *dst, char *hintText, char *initialText, int bufS
 
 void    waitAllKeysReleased(void)
 {
-    while (1)
-    {
-        hidScanInput();
-        if ((hidKeysDown() | hidKeysHeld() | hidKeysUp()) == 0)
-            return;
-    }
+    waitNoKeys();
+}
+
+static bool debugFrame(void *arg)
+{
+    return (osGetTime() < *(u64 *)arg);
 }
 
 void    debug(char *str, int seconds)
 {
-    time_t t;
+    u64     end;
 
     newAppTop(DEFAULT_COLOR, 0, "%s", str);
-    t = time(NULL);
-    while (t + seconds != time(NULL))
-        updateUI();
+    end = osGetTime() + seconds * 1000;
+    runUILoop(30, debugFrame, &end);
 }
 
-void    wait(int seconds)
+void    waitMs(u32 ms)
 {
-    time_t  t;
+    svcSleepThread((u64)ms * 1000000);
+}
 
-    t = time(NULL);
-    while (t + seconds != time(NULL));
+void    wait(int seconds)
+{
+    waitMs(seconds * 1000);
 }
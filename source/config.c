@@ -1,4 +1,17 @@
 #include "config.h"
+#include "fileIO.h"
+#include <zlib.h>
+
+#define CONFIG_FOOTER_MAGIC     0x47464E43 // "CNFG"
+
+// Appended to config_t in the file, an incomplete or damaged file is
+// detected on load instead of being used
+typedef struct  configFooter_s
+{
+    u32         magic;
+    u32         size;
+    u32         crc;
+}               configFooter_t;
 
 static bootNtrConfig_t  g_bnConfig = { 0 };
 static ntrConfig_t      g_ntrConfig = { 0 };
@@ -35,14 +48,27 @@ error:
 
 bool    loadConfigFromFile(config_t *config)
 {
-    FILE        *file = NULL;
+    u8              buffer[sizeof(config_t) + sizeof(configFooter_t)];
+    configFooter_t  *footer = (configFooter_t *)(buffer + sizeof(config_t));
+    fileIO_t        file;
+    u32             size;
+    bool            ok;
 
     if (!config) goto error;
     //if (!fileExists(configPath)) goto error;
-    file = fopen(configPath, "rb");
-    if (!file) goto error;
-    fread(config, sizeof(config_t), 1, file);
-    fclose(file);
+    fileRecover(configPath);
+    if (!fileOpen(&file, configPath, FILEIO_READ)) goto error;
+    ok = fileRead(&file, buffer, sizeof(buffer), &size);
+    fileClose(&file);
+    if (!ok) goto error;
+    // Files written before the footer was added are only config_t
+    if (size != sizeof(config_t))
+    {
+        if (size != sizeof(buffer)) goto error;
+        if (footer->magic != CONFIG_FOOTER_MAGIC || footer->size != sizeof(config_t)) goto error;
+        if (footer->crc != crc32(crc32(0L, Z_NULL, 0), buffer, sizeof(config_t))) goto error;
+    }
+    memcpy(config, buffer, sizeof(config_t));
 
     // Check version of the config file
     if (config->version != CURRENT_CONFIG_VERSION)
@@ -60,8 +86,9 @@ error:
 
 bool    saveConfig(void)
 {
-    FILE        *file = 0;
-    config_t    *config = g_bnConfig.config;
+    u8              buffer[sizeof(config_t) + sizeof(configFooter_t)];
+    configFooter_t  footer;
+    config_t        *config = g_bnConfig.config;
 
     if (!config)
         goto error;
@@ -69,11 +96,12 @@ bool    saveConfig(void)
     if (!fileExists(configDir))
         createDir(configDir);
     if (!fileExists(configDir)) goto error;
-    file = fopen(configPath, "wb");
-    if (!file) goto error;
-    fwrite(config, sizeof(config_t), 1, file);
-    fflush(file);
-    fclose(file);
+    footer.magic = CONFIG_FOOTER_MAGIC;
+    footer.size = sizeof(config_t);
+    footer.crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)config, sizeof(config_t));
+    memcpy(buffer, config, sizeof(config_t));
+    memcpy(buffer + sizeof(config_t), &footer, sizeof(footer));
+    if (!fileWriteAtomic(configPath, buffer, sizeof(buffer))) goto error;
     return (true);
 error:
     return (false);
@@ -76,11 +76,38 @@ typedef struct  ntrConfig_s
     char        path[0x100];
 }               ntrConfig_t;
 
+// Kernel cache interface used by kernelCallback, one per distinct table
+typedef enum
+{
+    KCACHE_NONE = 0,
+    KCACHE_NEW81,
+    KCACHE_NEW95,
+    KCACHE_NEW96,
+    KCACHE_NEW102,
+    KCACHE_NEW110,
+    KCACHE_NEW111,
+    KCACHE_NEW112,
+    KCACHE_NEW113,
+    KCACHE_NEW114, // also 11.8
+    KCACHE_NEW1114,
+    KCACHE_OLD90,
+    KCACHE_OLD96,
+    KCACHE_OLD110,
+    KCACHE_OLD111,
+    KCACHE_OLD112,
+    KCACHE_OLD113,
+    KCACHE_OLD114,
+    KCACHE_OLD118,
+    KCACHE_OLD1114,
+    KCACHE_COUNT
+}               kernelCacheSlot_t;
+
 typedef struct  bootNtrConfig_s
 {
     u32         FSPatchAddr;
     u32         SMPatchAddr;
     u32         SvcPatchAddr;
+    u32         kernelCacheSlot;
     u32         FSPid;
     u32         SMPid;
     u32         requireKernelHax;
@@ -4,18 +4,35 @@ static DVLB_s           *vshader_dvlb;
 static shaderProgram_s  program;
 static int              uLoc_projection;
 static C3D_Tex          *glyphSheets;
-static textVertex_s     *textVtxArray;
+static textVertex_s     *textVtxArray;  // of the current chunk
 static int              textVtxArrayPos;
+static u16              *indexArray;
+static int              indexArrayPos;
+static vtxChunk_t       vtxChunks[VTX_CHUNK_MAX];
+static int              vtxChunkCount;
+static int              vtxChunkIndex;
+static drawQuad_t       *quads;         // of the current chunk
+static int              quadCount;
+static int              quadFlushed;
+static u32              textColor = COLOR_BLANK;
+// State left by the last run, forgotten at each frame
+static C3D_Tex          *boundTexture;
+static int              envMode = -1;
+static u32              envColor;
+static drawStats_t      frameCounters;
+static drawStats_t      lastFrameStats;
 static drawTarget_t     top;
 static drawTarget_t     bottom;
 static bool             frameStarted = false;
 static gfxScreen_t      currentScreen = -1;
 static cursor_t         cursor[2] = { { 10, 10 },{ 10, 10 } };
 
-#define TEXT_VTX_ARRAY_COUNT (8 * 1024)
+#define QUAD_COUNT (TEXT_VTX_ARRAY_COUNT / 4)
 
 #define TEX_MIN_SIZE 64
 
+//#define NO_STATE_CACHE //Set the whole state for each run, to compare the command buffer usage
+
 //Grabbed from: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
 unsigned int nextPow2(unsigned int v)
 {
@@ -29,29 +46,108 @@ unsigned int nextPow2(unsigned int v)
     return (v >= TEX_MIN_SIZE ? v : TEX_MIN_SIZE);
 }
 
+static inline s16 toFixed(float value, float scale)
+{
+    value *= scale;
+    return ((s16)(value < 0.0f ? value - 0.5f : value + 0.5f));
+}
+
 static void addTextVertex(float vx, float vy, float vz, float tx, float ty)
 {
     textVertex_s    *vtx;
 
     vtx = &textVtxArray[textVtxArrayPos++];
-    vtx->position[0] = vx;
-    vtx->position[1] = vy;
-    vtx->position[2] = 0.0f;
-    vtx->texcoord[0] = tx;
-    vtx->texcoord[1] = ty;
+    vtx->position[0] = toFixed(vx, VTX_POS_SCALE);
+    vtx->position[1] = toFixed(vy, VTX_POS_SCALE);
+    vtx->texcoord[0] = toFixed(tx, VTX_TEX_SCALE);
+    vtx->texcoord[1] = toFixed(ty, VTX_TEX_SCALE);
 }
 
 void printVertex(textVertex_s *vtx)
 {
-    printf("Vtx: pos[0] %f, pos[1] %f pos[2] %f, tx[0] %f, tx[1] %f\n",
-        vtx->position[0],
-        vtx->position[1],
-        vtx->position[2],
-        vtx->texcoord[0],
-        vtx->texcoord[1]
+    printf("Vtx: pos[0] %f, pos[1] %f, tx[0] %f, tx[1] %f\n",
+        vtx->position[0] / VTX_POS_SCALE,
+        vtx->position[1] / VTX_POS_SCALE,
+        vtx->texcoord[0] / VTX_TEX_SCALE,
+        vtx->texcoord[1] / VTX_TEX_SCALE
         );
 }
 
+static void flushQuads(void);
+
+static bool addVtxChunk(void)
+{
+    vtxChunk_t  *chunk;
+
+    if (vtxChunkCount >= VTX_CHUNK_MAX)
+        return (false);
+    chunk = &vtxChunks[vtxChunkCount];
+    chunk->vertices = (textVertex_s *)linearAlloc(sizeof(textVertex_s) * TEXT_VTX_ARRAY_COUNT);
+    chunk->indices = (u16 *)linearAlloc(sizeof(u16) * QUAD_COUNT * 6);
+    if (!chunk->vertices || !chunk->indices)
+    {
+        if (chunk->vertices) linearFree(chunk->vertices);
+        if (chunk->indices) linearFree(chunk->indices);
+        memset(chunk, 0, sizeof(*chunk));
+        return (false);
+    }
+    vtxChunkCount++;
+    return (true);
+}
+
+static void useVtxChunk(int index)
+{
+    vtxChunkIndex = index;
+    textVtxArray = vtxChunks[index].vertices;
+    indexArray = vtxChunks[index].indices;
+    textVtxArrayPos = 0;
+    indexArrayPos = 0;
+    quadCount = quadFlushed = 0;
+}
+
+// The chunk is full: draw what it holds and go on in the next one. The GPU
+// reads them all at the end of the frame, none is reused before the next.
+static bool nextVtxChunk(void)
+{
+    flushQuads();
+    if (vtxChunkIndex + 1 >= vtxChunkCount && !addVtxChunk())
+        return (false);
+    useVtxChunk(vtxChunkIndex + 1);
+    return (true);
+}
+
+// Reserve the 4 vertices of a quad, drawn with the others at the next flush
+static bool pushQuad(C3D_Tex *texture, u8 mode, u32 color)
+{
+    drawQuad_t  *quad;
+
+    if (textVtxArrayPos + 4 > TEXT_VTX_ARRAY_COUNT && !nextVtxChunk())
+        return (false);
+    quad = &quads[quadCount++];
+    quad->texture = texture;
+    quad->color = color;
+    quad->mode = mode;
+    quad->vertex = textVtxArrayPos;
+    return (true);
+}
+
+// The glyphs of a string can go in any order, group them by sheet.
+// Stable, so the glyphs of a sheet keep their order.
+static void sortQuadsByTexture(int first)
+{
+    drawQuad_t  quad;
+    int         i;
+    int         j;
+
+    for (i = first + 1; i < quadCount; i++)
+    {
+        quad = quads[i];
+        for (j = i; j > first && quads[j - 1].texture > quad.texture; j--)
+            quads[j] = quads[j - 1];
+        quads[j] = quad;
+    }
+}
+
 static void resetC3Denv() {
     C3D_TexEnv *env;
     for (int i = 0; i < 4; i++) {
@@ -60,13 +156,12 @@ static void resetC3Denv() {
     }
 }
 
-static void bindImageGreyScale(C3D_Tex *texture, u32 texture_color) {
+static void setupGreyScaleEnv(void) {
     //((0.3 * R) + (0.59 * G) + (0.11 * B)). -> 0xFF1C964C
     C3D_TexEnv  *env;
     u32 greyMask = 0xFF1C964C;
     resetC3Denv();
 
-    C3D_TexBind(0, texture);
     env = C3D_GetTexEnv(0);
     C3D_TexEnvSrc(env, C3D_RGB, GPU_TEXTURE0, GPU_CONSTANT, 0);
     C3D_TexEnvSrc(env, C3D_Alpha, GPU_TEXTURE0, 0, 0);
@@ -74,7 +169,6 @@ static void bindImageGreyScale(C3D_Tex *texture, u32 texture_color) {
     C3D_TexEnvOpAlpha(env, 0, 0, 0);
     C3D_TexEnvFunc(env, C3D_RGB, GPU_MODULATE);
     C3D_TexEnvFunc(env, C3D_Alpha, GPU_REPLACE);
-    C3D_TexEnvColor(env, texture_color);
     env = C3D_GetTexEnv(1);
     C3D_TexEnvSrc(env, C3D_RGB, GPU_PREVIOUS, GPU_CONSTANT, 0);
     C3D_TexEnvSrc(env, C3D_Alpha, GPU_PREVIOUS, 0, 0);
@@ -100,21 +194,124 @@ static void bindImageGreyScale(C3D_Tex *texture, u32 texture_color) {
     C3D_TexEnvFunc(env, C3D_Alpha, GPU_REPLACE);
 }
 
-static void bindTexture(C3D_Tex *texture, u32 texture_color)
+// The other setups only use the first stage, the 3 others stay passthrough
+static void setupStage0Env(int mode)
 {
     C3D_TexEnv  *env;
-    resetC3Denv();
 
-    C3D_TexBind(0, texture);
     env = C3D_GetTexEnv(0);
+    C3D_TexEnvInit(env);
     C3D_TexEnvBufUpdate(C3D_RGB, 0);
-    C3D_TexEnvSrc(env, C3D_RGB, GPU_TEXTURE0, GPU_CONSTANT, 0);
-    C3D_TexEnvSrc(env, C3D_Alpha, GPU_TEXTURE0, 0, 0);
     C3D_TexEnvOpRgb(env, 0, 0, 0);
     C3D_TexEnvOpAlpha(env, 0, 0, 0);
-    C3D_TexEnvFunc(env, C3D_RGB, GPU_MODULATE);
-    C3D_TexEnvFunc(env, C3D_Alpha, GPU_REPLACE);
-    C3D_TexEnvColor(env, texture_color);
+    if (mode == DRAW_TEXT)
+    {
+        C3D_TexEnvSrc(env, C3D_RGB, GPU_CONSTANT, 0, 0);
+        C3D_TexEnvSrc(env, C3D_Alpha, GPU_TEXTURE0, GPU_CONSTANT, 0);
+        C3D_TexEnvFunc(env, C3D_RGB, GPU_REPLACE);
+        C3D_TexEnvFunc(env, C3D_Alpha, GPU_MODULATE);
+    }
+    else if (mode == DRAW_RECTANGLE)
+    {
+        C3D_TexEnvSrc(env, C3D_RGB, GPU_TEXTURE0, 0, 0);
+        C3D_TexEnvSrc(env, C3D_Alpha, GPU_CONSTANT, 0, 0);
+        C3D_TexEnvFunc(env, C3D_Both, GPU_REPLACE);
+    }
+    else
+    {
+        C3D_TexEnvSrc(env, C3D_RGB, GPU_TEXTURE0, GPU_CONSTANT, 0);
+        C3D_TexEnvSrc(env, C3D_Alpha, GPU_TEXTURE0, 0, 0);
+        C3D_TexEnvFunc(env, C3D_RGB, GPU_MODULATE);
+        C3D_TexEnvFunc(env, C3D_Alpha, GPU_REPLACE);
+    }
+}
+
+// Only what changed since the previous run goes to the command buffer:
+// citro3d uploads a TexEnv stage again as soon as it's fetched
+static void bindQuadState(drawQuad_t *quad)
+{
+    int     mode;
+    u32     color;
+
+    mode = quad->mode;
+    color = quad->color;
+#ifdef CITRA //Citra doesn't like the text env
+    if (mode == DRAW_TEXT)
+    {
+        mode = DRAW_TEXTURE;
+        color = COLOR_BLANK;
+    }
+#endif
+#ifdef NO_STATE_CACHE
+    boundTexture = NULL;
+    envMode = -1;
+#endif
+    if (quad->texture != boundTexture)
+    {
+        boundTexture = quad->texture;
+        C3D_TexBind(0, boundTexture);
+        frameCounters.texBinds++;
+    }
+    if (mode != envMode)
+    {
+        if (mode == DRAW_GREYSCALE)
+            setupGreyScaleEnv();
+        else
+        {
+            if (envMode == DRAW_GREYSCALE || envMode == -1)
+                resetC3Denv();
+            setupStage0Env(mode);
+        }
+        envMode = mode;
+        envColor = ~color;
+        frameCounters.envChanges++;
+    }
+    if (color != envColor)
+    {
+        envColor = color;
+        C3D_TexEnvColor(C3D_GetTexEnv(0), color);
+    }
+}
+
+// Draw the quads queued since the last flush, one call per run of quads
+// sharing the texture and the TexEnv setup
+static void flushQuads(void)
+{
+    C3D_BufInfo *bufInfo;
+    drawQuad_t  *run;
+    u16         *index;
+    u16         vertex;
+    int         i;
+    int         j;
+
+    if (quadFlushed == quadCount)
+        return;
+    bufInfo = C3D_GetBufInfo();
+    BufInfo_Init(bufInfo);
+    BufInfo_Add(bufInfo, textVtxArray, sizeof(textVertex_s), 2, 0x10);
+    for (i = quadFlushed; i < quadCount; i = j)
+    {
+        run = &quads[i];
+        index = &indexArray[indexArrayPos];
+        for (j = i; j < quadCount && quads[j].texture == run->texture
+            && quads[j].mode == run->mode && quads[j].color == run->color; j++)
+        {
+            // left bottom, right bottom, left top, right top
+            vertex = quads[j].vertex;
+            *index++ = vertex;
+            *index++ = vertex + 1;
+            *index++ = vertex + 2;
+            *index++ = vertex + 2;
+            *index++ = vertex + 1;
+            *index++ = vertex + 3;
+        }
+        bindQuadState(run);
+        frameCounters.drawCalls++;
+        frameCounters.quads += j - i;
+        C3D_DrawElements(GPU_TRIANGLES, (j - i) * 6, C3D_UNSIGNED_SHORT, &indexArray[indexArrayPos]);
+        indexArrayPos += (j - i) * 6;
+    }
+    quadFlushed = quadCount;
 }
 
 void setSpritePos(sprite_t *sprite, float posX, float posY)
@@ -132,7 +329,6 @@ void drawSprite(sprite_t *sprite)
     float       v;
     float       x;
     float       y;
-    int         arrayIndex;
     C3D_Tex     *texture;
 
     if (!sprite || sprite->isHidden) return;
@@ -147,26 +343,14 @@ void drawSprite(sprite_t *sprite)
     width = floor(width * sprite->amount);
     u *= sprite->amount;
 
-    C3D_BufInfo *bufInfo = C3D_GetBufInfo();
-    BufInfo_Init(bufInfo);
-    BufInfo_Add(bufInfo, textVtxArray, sizeof(textVertex_s), 2, 0x10);
+    //Queue the quad with the sprite's texture
+    if (!pushQuad(texture, sprite->isGreyedOut ? DRAW_GREYSCALE : DRAW_TEXTURE, sprite->drawColor))
+        return;
     //Set the vertices
-    arrayIndex = textVtxArrayPos;
     addTextVertex(x, y + height, sprite->depth, 0.0f, v); //left bottom
     addTextVertex(x + width, y + height, sprite->depth, u, v); //right bottom
     addTextVertex(x, y, sprite->depth, 0.0f, 0.0f); //left top
     addTextVertex(x + width, y, sprite->depth, u, 0.0f); //right top
-
-    //Bind the sprite's texture
-    if (sprite->isGreyedOut) {
-        bindImageGreyScale(texture, sprite->drawColor);
-    }
-    else {
-        bindTexture(texture, sprite->drawColor);
-    }
-
-    //Draw
-    C3D_DrawArrays(GPU_TRIANGLE_STRIP, arrayIndex, 4);
 }
 
 void drawRectangle(rectangle_t *rectangle)
@@ -175,8 +359,6 @@ void drawRectangle(rectangle_t *rectangle)
     float       width;
     float       x;
     float       y;
-    int         arrayIndex;
-    C3D_TexEnv  *env;
 
     if (!rectangle) return;
     height = rectangle->height;
@@ -184,29 +366,13 @@ void drawRectangle(rectangle_t *rectangle)
     x = rectangle->posX;
     y = rectangle->posY;
 
-    C3D_BufInfo *bufInfo = C3D_GetBufInfo();
-    BufInfo_Init(bufInfo);
-    BufInfo_Add(bufInfo, textVtxArray, sizeof(textVertex_s), 2, 0x10);
+    if (!pushQuad(&(rectangle->sprite->texture), DRAW_RECTANGLE, 0xFFFFFFFF))
+        return;
     //Set the vertices
-    arrayIndex = textVtxArrayPos;
     addTextVertex(x, y + height, rectangle->depth, 0.0f, 1.f); //left bottom
     addTextVertex(x + width, y + height, rectangle->depth, 1.f, 1.f); //right bottom
     addTextVertex(x, y, rectangle->depth, 0.0f, 0.0f); //left top
     addTextVertex(x + width, y, rectangle->depth, 1.f, 0.0f); //right top
-
-    resetC3Denv();
-    env = C3D_GetTexEnv(0);
-    C3D_TexBind(0, &(rectangle->sprite->texture));
-    C3D_TexEnvBufUpdate(C3D_RGB, 0);
-    C3D_TexEnvSrc(env, C3D_RGB, GPU_TEXTURE0, 0, 0);
-    C3D_TexEnvSrc(env, C3D_Alpha, GPU_CONSTANT, 0, 0);
-    C3D_TexEnvOpRgb(env, 0, 0, 0);
-    C3D_TexEnvOpAlpha(env, 0, 0, 0);
-    C3D_TexEnvFunc(env, C3D_Both, GPU_REPLACE);
-    C3D_TexEnvColor(env, 0xFFFFFFFF);
-
-    //Draw
-    C3D_DrawArrays(GPU_TRIANGLE_STRIP, arrayIndex, 4);
 }
 
 sprite_t *newSprite(int width, int height)
@@ -268,8 +434,8 @@ static void sceneInit(void)
     // Configure attributes for use with the vertex shader
     attrInfo = C3D_GetAttrInfo();
     AttrInfo_Init(attrInfo);
-    AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3); // v0=position
-    AttrInfo_AddLoader(attrInfo, 1, GPU_FLOAT, 2); // v1=texcoord
+    AttrInfo_AddLoader(attrInfo, 0, GPU_SHORT, 2); // v0=position
+    AttrInfo_AddLoader(attrInfo, 1, GPU_SHORT, 2); // v1=texcoord
 
     // Compute the projection matrix
     Mtx_OrthoTilt(&top.projection, 0.0f, 400.0f, 240.0f, 0.0f, 0.0f, 1.0f, true);
@@ -292,14 +458,26 @@ static void sceneInit(void)
         tex->param = GPU_TEXTURE_MAG_FILTER(GPU_LINEAR) | GPU_TEXTURE_MIN_FILTER(GPU_LINEAR)
             | GPU_TEXTURE_WRAP_S(GPU_CLAMP_TO_EDGE) | GPU_TEXTURE_WRAP_T(GPU_CLAMP_TO_EDGE);
     }
-    // Create the text vertex array
-    textVtxArray = (textVertex_s*)linearAlloc(sizeof(textVertex_s)*TEXT_VTX_ARRAY_COUNT);
+    // Create the first vertex chunk and the queue of its quads, more chunks
+    // are added when a frame needs them
+    addVtxChunk();
+    useVtxChunk(0);
+    quads = (drawQuad_t *)malloc(sizeof(drawQuad_t) * QUAD_COUNT);
 }
 
 static void sceneExit(void)
 {
+    int     i;
+
     // Free the textures
     free(glyphSheets);
+    free(quads);
+    for (i = 0; i < vtxChunkCount; i++)
+    {
+        linearFree(vtxChunks[i].vertices);
+        linearFree(vtxChunks[i].indices);
+    }
+    vtxChunkCount = 0;
 
     // Free the shader program
     shaderProgramFree(&program);
@@ -336,6 +514,9 @@ void drawEndFrame(void)
 {
     if (frameStarted)
     {
+        flushQuads();
+        frameCounters.cmdBufBytes = C3D_GetCmdBufUsage() * C3D_DEFAULT_CMDBUF_SIZE;
+        lastFrameStats = frameCounters;
         C3D_FrameEnd(0);
         frameStarted = false;
     }
@@ -347,20 +528,16 @@ void drawExit(void)
     C3D_Fini();
 }
 
-void setTextColor(u32 color)
+// Counters of the last frame sent to the GPU
+void drawGetStats(drawStats_t *stats)
 {
-#ifndef CITRA
-    C3D_TexEnv  *env;
+    *stats = lastFrameStats;
+}
 
-    env = C3D_GetTexEnv(0);
-    C3D_TexEnvSrc(env, C3D_RGB, GPU_CONSTANT, 0, 0);
-    C3D_TexEnvSrc(env, C3D_Alpha, GPU_TEXTURE0, GPU_CONSTANT, 0);
-    C3D_TexEnvOpRgb(env, 0, 0, 0);
-    C3D_TexEnvOpAlpha(env, 0, 0, 0);
-    C3D_TexEnvFunc(env, C3D_RGB, GPU_REPLACE);
-    C3D_TexEnvFunc(env, C3D_Alpha, GPU_MODULATE);
-    C3D_TexEnvColor(env, color);
-#endif
+// Color of the next renderText calls
+void setTextColor(u32 color)
+{
+    textColor = color;
 }
 
 void getTextSizeInfos(float *width, float scaleX, float scaleY, const char *text)
@@ -423,22 +600,18 @@ void renderText(float x, float y, float scaleX, float scaleY, bool baseline, con
     float           depth = 0;
     u32             flags;
     u32             code;
-    int             lastSheet;
     int             glyphIdx;
-    int             arrayIndex;
+    int             firstQuad;
+    int             firstChunk;
     ssize_t         units;
     float           firstX;
-    C3D_BufInfo     *bufInfo;
     fontGlyphPos_s  data;
     const u8        *p = (const u8 *)text;
 
-    // Configure buffers
-    bufInfo = C3D_GetBufInfo();
-    BufInfo_Init(bufInfo);
-    BufInfo_Add(bufInfo, textVtxArray, sizeof(textVertex_s), 2, 0x10);
     firstX = x;
+    firstQuad = quadCount;
+    firstChunk = vtxChunkIndex;
     flags = GLYPH_POS_CALC_VTXCOORD | (baseline ? GLYPH_POS_AT_BASELINE : 0);
-    lastSheet = -1;
     do
     {
         if (!*p)
@@ -457,30 +630,22 @@ void renderText(float x, float y, float scaleX, float scaleY, bool baseline, con
             glyphIdx = fontGlyphIndexFromCodePoint(NULL, code);
             fontCalcGlyphPos(&data, NULL, glyphIdx, flags, scaleX, scaleY);
 
-            // Bind the correct texture sheet
-            if (data.sheetIndex != lastSheet)
-            {
-                lastSheet = data.sheetIndex;
-                C3D_TexBind(0, &glyphSheets[lastSheet]);
-            }
-
-            arrayIndex = textVtxArrayPos;
-            if ((arrayIndex + 4) >= TEXT_VTX_ARRAY_COUNT)
+            // Queue the glyph with its texture sheet
+            if (!pushQuad(&glyphSheets[data.sheetIndex], DRAW_TEXT, textColor))
                 break; // We can't render more characters
 
-                       // Add the vertices to the array
+            // Add the vertices to the array
             addTextVertex(x + data.vtxcoord.left, y + data.vtxcoord.bottom, depth, data.texcoord.left, data.texcoord.bottom);
             addTextVertex(x + data.vtxcoord.right, y + data.vtxcoord.bottom, depth, data.texcoord.right, data.texcoord.bottom);
             addTextVertex(x + data.vtxcoord.left, y + data.vtxcoord.top, depth, data.texcoord.left, data.texcoord.top);
             addTextVertex(x + data.vtxcoord.right, y + data.vtxcoord.top, depth, data.texcoord.right, data.texcoord.top);
 
-            // Draw the glyph
-            C3D_DrawArrays(GPU_TRIANGLE_STRIP, arrayIndex, 4);
-
             x += data.xAdvance;
 
         }
     } while (code > 0);
+    // The beginning of the string may be in a chunk already drawn
+    sortQuadsByTexture(firstChunk == vtxChunkIndex ? firstQuad : 0);
     if (cursor)
     {
         cursor->posX = x;
@@ -506,28 +671,37 @@ void drawText(screenPos_t pos, float size, u32 color, char *text, ...)
 
 }
 
-void updateScreen(void)
+// Waits for the frame slot set by C3D_FrameRate. With skipIfBusy, gives up
+// instead of waiting when the GPU is still busy with the previous frame.
+bool drawBeginFrame(bool skipIfBusy)
 {
-    if (frameStarted)
-        C3D_FrameEnd(0);
-    else
-        frameStarted = true;
-    C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
-    textVtxArrayPos = 0;
+    if (frameStarted) return (true);
+    if (!C3D_FrameBegin(C3D_FRAME_SYNCDRAW | (skipIfBusy ? C3D_FRAME_NONBLOCK : 0)))
+        return (false);
+    frameStarted = true;
+    useVtxChunk(0);
+    boundTexture = NULL;
+    envMode = -1;
+    memset(&frameCounters, 0, sizeof(frameCounters));
     cursor[0] = (cursor_t){ 10, 10 };
     cursor[1] = (cursor_t){ 10, 10 };
     currentScreen = -1;
+    return (true);
+}
+
+void updateScreen(void)
+{
+    drawEndFrame();
 }
 
 void setScreen(gfxScreen_t screen)
 {
     if (screen == currentScreen) return;
-    currentScreen = screen;
     if (!frameStarted)
-    {
-        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
-        frameStarted = true;
-    }
+        drawBeginFrame(false);
+    // The queued quads belong to the previous target
+    flushQuads();
+    currentScreen = screen;
     if (screen == GFX_TOP)
     {
         C3D_FrameDrawOn(top.target);
@@ -61,12 +61,56 @@ typedef struct  rectangle_s
     GX_TRANSFER_IN_FORMAT(GX_TRANSFER_FMT_RGBA8) | GX_TRANSFER_OUT_FORMAT(GX_TRANSFER_FMT_RGBA8) | \
     GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_NO))
 
+// Fixed point UI vertex: 2D screen position in 1/8 pixels and texture
+// coordinates in 1/16384, vshader.v.pica scales them back
+#define VTX_POS_SCALE           8.0f
+#define VTX_TEX_SCALE           16384.0f
+
 typedef struct
 {
-    float   position[3];
-    float   texcoord[2];
+    s16     position[2];
+    s16     texcoord[2];
 }           textVertex_s;
 
+#define TEXT_VTX_ARRAY_COUNT    (8 * 1024)  // vertices per chunk
+#define VTX_CHUNK_MAX           8
+
+// Vertices of the frame and the indices drawing them, a frame goes on in a
+// new chunk when one is full
+typedef struct  vtxChunk_s
+{
+    textVertex_s    *vertices;
+    u16             *indices;
+}               vtxChunk_t;
+
+// TexEnv setups of the queued quads
+enum
+{
+    DRAW_TEXTURE,
+    DRAW_GREYSCALE,
+    DRAW_TEXT,
+    DRAW_RECTANGLE
+};
+
+// A textured quad waiting for the flush, the runs of consecutive quads with
+// the same state are drawn with a single call
+typedef struct  drawQuad_s
+{
+    C3D_Tex     *texture;
+    u32         color;      // TexEnv constant
+    u16         vertex;     // first of its 4 vertices
+    u8          mode;
+}               drawQuad_t;
+
+typedef struct  drawStats_s
+{
+    u32         cmdBufBytes;    // GPU commands of the frame
+    u32         drawCalls;
+    u32         quads;
+    u32         texBinds;
+    u32         envChanges;
+}               drawStats_t;
+
 typedef struct  drawTarget_s
 {
     C3D_RenderTarget    *target;
@@ -89,8 +133,10 @@ void        setTextColor(u32 color);
 void        renderText(float x, float y, float scaleX, float scaleY, bool baseline, const char *text, cursor_t *cursor);
 void        drawText(screenPos_t pos, float size, u32 color, char *text, ...);
 void        findBestSize(float *sizeX, float *sizeY, float posXMin, float posXMax, float sizeMax, const char *text);
+bool        drawBeginFrame(bool skipIfBusy);
 void        setScreen(gfxScreen_t screen);
 void        updateScreen(void);
+void        drawGetStats(drawStats_t *stats);
 
 sprite_t    *newSprite(int width, int height);
 Result      newSpriteFromPNG(sprite_t **out, const char *filename);
@@ -64,17 +64,15 @@ bool        drawScreen(void *self)
     drawableScreen_t    *screen;
     drawableObject_t    *obj;
     int                 i;
-    int                 elementsCount;
 
     if (!self) goto error;
     screen = (drawableScreen_t *)self;
-    elementsCount = screen->elementsCount;
     if (screen->background)
         screen->background->draw(screen->background);
-    for (i = 0; i < elementsCount; i++)
+    // Buttons run their callback from their draw, the list may change
+    for (i = 0; i < screen->elementsCount; i++)
     {
-        obj = (drawableObject_t *)screen->elementList[i];
-        if (!obj) continue;
+        obj = (drawableObject_t *)screen->entries[i].object;
         obj->draw(obj);
     }
     return (true);
@@ -82,23 +80,108 @@ error:
     return (false);
 }
 
-void        addObjectToScreen(drawableScreen_t *screen, void *object)
+static int  findEntry(drawableScreen_t *screen, u32 handle)
 {
-    if (!screen || !object || screen->elementsCount >= MAX_ELEMENTS) goto error;
-    screen->elementList[screen->elementsCount] = (int)object;
+    int     i;
+
+    for (i = 0; i < screen->elementsCount; i++)
+        if (screen->entries[i].handle == handle)
+            return (i);
+    return (-1);
+}
+
+// Keep the entries sorted, an object goes after the ones of the same depth
+static void insertEntry(drawableScreen_t *screen, sceneEntry_t *entry)
+{
+    int     i;
+
+    i = screen->elementsCount;
+    while (i > 0 && (screen->entries[i - 1].depth > entry->depth
+        || (screen->entries[i - 1].depth == entry->depth && screen->entries[i - 1].handle > entry->handle)))
+    {
+        screen->entries[i] = screen->entries[i - 1];
+        i--;
+    }
+    screen->entries[i] = *entry;
     screen->elementsCount++;
+}
+
+static void removeEntry(drawableScreen_t *screen, int index)
+{
+    screen->elementsCount--;
+    memmove(&screen->entries[index], &screen->entries[index + 1],
+        (screen->elementsCount - index) * sizeof(sceneEntry_t));
+}
+
+u32         addObjectToScreenAt(drawableScreen_t *screen, void *object, float depth)
+{
+    sceneEntry_t    entry;
+    sceneEntry_t    *entries;
+    int             capacity;
+
+    if (!screen || !object) goto error;
+    if (screen->elementsCount >= screen->capacity)
+    {
+        capacity = screen->capacity ? screen->capacity * 2 : SCENE_MIN_CAPACITY;
+        entries = (sceneEntry_t *)realloc(screen->entries, capacity * sizeof(sceneEntry_t));
+        if (!entries) goto error;
+        screen->entries = entries;
+        screen->capacity = capacity;
+    }
+    entry.object = object;
+    entry.depth = depth;
+    entry.handle = ++screen->nextHandle;
+    insertEntry(screen, &entry);
+    return (entry.handle);
+error:
+    return (0);
+}
+
+// Returns the handle of the object, 0 if it couldn't be added
+u32         addObjectToScreen(drawableScreen_t *screen, void *object)
+{
+    return (addObjectToScreenAt(screen, object, 0.0f));
+}
+
+void        *removeObjectFromScreen(drawableScreen_t *screen, u32 handle)
+{
+    void    *ret;
+    int     i;
+
+    if (!screen || (i = findEntry(screen, handle)) < 0) goto error;
+    ret = screen->entries[i].object;
+    removeEntry(screen, i);
+    return (ret);
+error:
+    return (NULL);
+}
+
+void        setObjectDepth(drawableScreen_t *screen, u32 handle, float depth)
+{
+    sceneEntry_t    entry;
+    int             i;
+
+    if (!screen || (i = findEntry(screen, handle)) < 0) goto error;
+    entry = screen->entries[i];
+    entry.depth = depth;
+    removeEntry(screen, i);
+    insertEntry(screen, &entry);
 error:
     return;
 }
 
+// Last one added, whatever its depth
 void        *removeLastObjectFromScreen(drawableScreen_t *screen)
 {
-    void    *ret;
+    u32     last;
+    int     i;
+
     if (!screen || !screen->elementsCount) goto error;
-    ret = (void *)screen->elementList[screen->elementsCount - 1];
-    screen->elementList[screen->elementsCount - 1] = 0;
-    screen->elementsCount--;
-    return (ret);
+    last = 0;
+    for (i = 0; i < screen->elementsCount; i++)
+        if (screen->entries[i].handle > last)
+            last = screen->entries[i].handle;
+    return (removeObjectFromScreen(screen, last));
 error:
     return (NULL);
 }
@@ -1,6 +1,6 @@
 #ifndef DRAWABLEOBJECT_H
 #define DRAWABLEOBJECT_H
-#define MAX_ELEMENTS 15
+#define SCENE_MIN_CAPACITY 16
 
 #include "draw.h"
 
@@ -52,14 +52,23 @@ typedef struct   backgroundScreen_s
 
 }                backgroundScreen_t;
 
+typedef struct  sceneEntry_s
+{
+    void        *object;
+    float       depth;
+    u32         handle;     // also the insertion order
+}               sceneEntry_t;
+
 typedef struct  drawableScreen_s
 {
     /* herited from drawableObject_t */
     bool        (*draw)(void *self);
 
     backgroundScreen_t  *background;
+    sceneEntry_t        *entries;   // by depth, then by insertion
     int                 elementsCount;
-    int                 elementList[MAX_ELEMENTS];
+    int                 capacity;
+    u32                 nextHandle;
 }               drawableScreen_t;
 
 backgroundScreen_t  *newBackgroundObject(sprite_t *background, \
@@ -70,7 +79,10 @@ void        changeBackgroundFooter(backgroundScreen_t *bg, sprite_t *footer);
 
 drawableScreen_t    *newDrawableScreen(backgroundScreen_t *background);
 bool        drawScreen(void *self);
-void        addObjectToScreen(drawableScreen_t *screen, void *object);
+u32         addObjectToScreen(drawableScreen_t *screen, void *object);
+u32         addObjectToScreenAt(drawableScreen_t *screen, void *object, float depth);
+void        *removeObjectFromScreen(drawableScreen_t *screen, u32 handle);
+void        setObjectDepth(drawableScreen_t *screen, u32 handle, float depth);
 void        *removeLastObjectFromScreen(drawableScreen_t *screen);
 void        clearObjectListFromScreen(drawableScreen_t *screen);
 
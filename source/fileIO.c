@@ -0,0 +1,211 @@
+#include "fileIO.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __3DS__
+
+#include <3ds.h>
+
+// Path on the SD archive, NULL if the file isn't on the SD
+static const char   *sdPath(const char *path)
+{
+    if (!strncmp(path, "sdmc:", 5))
+        return (path + 5);
+    if (*path == '/')
+        return (path);
+    return (NULL);
+}
+
+static bool fsOpen(fileIO_t *file, const char *path, fileMode_t mode)
+{
+    Handle  handle;
+    u32     flags;
+
+    flags = mode == FILEIO_WRITE ? FS_OPEN_WRITE | FS_OPEN_CREATE : FS_OPEN_READ;
+    if (R_FAILED(FSUSER_OpenFileDirectly(&handle, ARCHIVE_SDMC, fsMakePath(PATH_EMPTY, ""),
+                                         fsMakePath(PATH_ASCII, path), flags, 0)))
+        return (false);
+    if (mode == FILEIO_WRITE && R_FAILED(FSFILE_SetSize(handle, 0)))
+    {
+        FSFILE_Close(handle);
+        return (false);
+    }
+    file->handle = handle;
+    return (true);
+}
+
+#endif
+
+bool    fileOpen(fileIO_t *file, const char *path, fileMode_t mode)
+{
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+    if (!path)
+        return (false);
+#ifdef __3DS__
+    if (sdPath(path))
+        return (fsOpen(file, sdPath(path), mode));
+#endif
+    if (mode == FILEIO_WRITE)
+        file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    else
+        file->fd = open(path, O_RDONLY);
+    return (file->fd >= 0);
+}
+
+bool    fileGetSize(fileIO_t *file, u64 *size)
+{
+    struct stat st;
+
+#ifdef __3DS__
+    if (file->handle)
+        return (R_SUCCEEDED(FSFILE_GetSize(file->handle, size)));
+#endif
+    if (fstat(file->fd, &st))
+        return (false);
+    *size = st.st_size;
+    return (true);
+}
+
+bool    fileSetSize(fileIO_t *file, u64 size)
+{
+#ifdef __3DS__
+    if (file->handle)
+        return (R_SUCCEEDED(FSFILE_SetSize(file->handle, size)));
+#endif
+    return (!ftruncate(file->fd, size));
+}
+
+bool    fileRead(fileIO_t *file, void *buffer, u32 size, u32 *bytesRead)
+{
+    u8      *dst = (u8 *)buffer;
+    u32     done;
+    ssize_t ret;
+
+    for (done = 0; done < size; done += ret)
+    {
+#ifdef __3DS__
+        if (file->handle)
+        {
+            u32 count;
+
+            if (R_FAILED(FSFILE_Read(file->handle, &count, file->offset + done, dst + done, size - done)))
+                return (false);
+            ret = count;
+        }
+        else
+#endif
+        ret = read(file->fd, dst + done, size - done);
+        if (ret < 0 && errno == EINTR)
+            ret = 0;
+        else if (ret < 0)
+            return (false);
+        else if (ret == 0)
+            break;
+    }
+    file->offset += done;
+    if (bytesRead)
+        *bytesRead = done;
+    return (true);
+}
+
+bool    fileWrite(fileIO_t *file, const void *buffer, u32 size)
+{
+    const u8    *src = (const u8 *)buffer;
+    u32         done;
+    ssize_t     ret;
+
+    for (done = 0; done < size; done += ret)
+    {
+#ifdef __3DS__
+        if (file->handle)
+        {
+            u32 count;
+
+            if (R_FAILED(FSFILE_Write(file->handle, &count, file->offset + done, src + done, size - done, 0)))
+                return (false);
+            ret = count;
+        }
+        else
+#endif
+        ret = write(file->fd, src + done, size - done);
+        if (ret < 0 && errno == EINTR)
+            ret = 0;
+        else if (ret <= 0)
+            return (false);
+    }
+    file->offset += done;
+    return (true);
+}
+
+bool    fileFlush(fileIO_t *file)
+{
+#ifdef __3DS__
+    if (file->handle)
+        return (R_SUCCEEDED(FSFILE_Flush(file->handle)));
+#endif
+    return (!fsync(file->fd));
+}
+
+bool    fileClose(fileIO_t *file)
+{
+    bool    ok = true;
+
+#ifdef __3DS__
+    if (file->handle)
+        ok = R_SUCCEEDED(FSFILE_Close(file->handle));
+    file->handle = 0;
+#endif
+    if (file->fd >= 0)
+        ok = !close(file->fd);
+    file->fd = -1;
+    return (ok);
+}
+
+bool    fileReplace(const char *from, const char *to)
+{
+#ifdef __3DS__
+    remove(to);
+#endif
+    return (!rename(from, to));
+}
+
+static void tempPath(char *dst, u32 size, const char *path)
+{
+    snprintf(dst, size, "%s.tmp", path);
+}
+
+bool    fileWriteAtomic(const char *path, const void *data, u32 size)
+{
+    fileIO_t    file;
+    char        tmp[0x110];
+    bool        ok;
+
+    tempPath(tmp, sizeof(tmp), path);
+    if (!fileOpen(&file, tmp, FILEIO_WRITE))
+        return (false);
+    ok = fileSetSize(&file, size) && fileWrite(&file, data, size) && fileFlush(&file);
+    ok &= fileClose(&file);
+    if (ok)
+        ok = fileReplace(tmp, path);
+    if (!ok)
+        remove(tmp);
+    return (ok);
+}
+
+bool    fileRecover(const char *path)
+{
+    char        tmp[0x110];
+    struct stat st;
+
+    tempPath(tmp, sizeof(tmp), path);
+    if (stat(tmp, &st))
+        return (false);
+    if (stat(path, &st))
+        rename(tmp, path);
+    return (true);
+}
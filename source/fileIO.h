@@ -0,0 +1,60 @@
+#ifndef FILEIO_H
+#define FILEIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __3DS__
+#include <3ds/types.h>
+#else
+typedef uint8_t   u8;
+typedef uint32_t  u32;
+typedef uint64_t  u64;
+#endif
+
+/*
+** Thin file layer for the large binaries. On the console SD paths ("sdmc:/"
+** or absolute) go straight to the FS service: no stdio buffer, every call
+** is one transfer into the caller's buffer, linear memory included. Page
+** aligned buffers are mapped by the kernel without a bounce copy. Anything
+** else (romfs:/) and the host tools use the POSIX backend.
+*/
+
+typedef enum    fileMode_e
+{
+    FILEIO_READ = 0,
+    FILEIO_WRITE        // created or truncated
+}               fileMode_t;
+
+typedef struct  fileIO_s
+{
+    u32         handle;     // FS service file handle, 0 on the POSIX backend
+    int         fd;
+    u64         offset;
+}               fileIO_t;
+
+bool    fileOpen(fileIO_t *file, const char *path, fileMode_t mode);
+bool    fileGetSize(fileIO_t *file, u64 *size);
+// Preallocate before a sequential write so the card isn't grown per write
+bool    fileSetSize(fileIO_t *file, u64 size);
+// Reads up to size bytes, *bytesRead is short only at the end of the file
+bool    fileRead(fileIO_t *file, void *buffer, u32 size, u32 *bytesRead);
+bool    fileWrite(fileIO_t *file, const void *buffer, u32 size);
+// Commit the written data to the card
+bool    fileFlush(fileIO_t *file);
+bool    fileClose(fileIO_t *file);
+
+// Rename from over to, which may exist. The FS service can't replace a file
+// so on the console to is deleted first: if that window is hit, to is
+// missing and from is complete, see fileRecover
+bool    fileReplace(const char *from, const char *to);
+// Write the whole buffer to path + ".tmp", flush it and rename it over
+// path. A power loss leaves either the old or the new file, never a mix.
+bool    fileWriteAtomic(const char *path, const void *data, u32 size);
+// Finish an atomic write interrupted between the delete and the rename.
+// The temp file may be partial if there was no file before: the caller
+// still has to validate what it reads. Returns true if a temp file was
+// left, i.e. a write to path was interrupted.
+bool    fileRecover(const char *path);
+
+#endif
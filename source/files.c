@@ -1,4 +1,5 @@
 #include "main.h"
+#include "fileIO.h"
 #include <errno.h>
 #include <sys/stat.h>
 
@@ -16,34 +17,54 @@ error:
     return (false);
 }
 
+// Large transfers: the SD card cost is per request, not per byte
+#define COPY_BUFFER_SIZE    (0x20000)
+
 int     copy_file(char *old_filename, char  *new_filename)
 {
-    FILE        *old_file = NULL;
-    FILE        *new_file = NULL;
-    t_BLOCK     value;
+    fileIO_t    old_file;
+    fileIO_t    new_file;
+    bool        created = false;
+    u8          *buffer = NULL;
+    u64         fileSize;
+    u32         size;
+
+    check_prim(!fileOpen(&old_file, old_filename, FILEIO_READ), FILE_COPY_ERROR);
+    created = fileOpen(&new_file, new_filename, FILEIO_WRITE);
+    check_prim(!created, FILE_COPY_ERROR);
+    buffer = (u8 *)malloc(COPY_BUFFER_SIZE);
+    check_prim(!buffer, FILE_COPY_ERROR);
+
+    // Size the destination once instead of growing it on every write
+    if (fileGetSize(&old_file, &fileSize) && fileSize > 0)
+        fileSetSize(&new_file, fileSize);
 
-    old_file = fopen(old_filename, "rb");
-    new_file = fopen(new_filename, "wb");
-    value = (t_BLOCK) { {0, 0, 0, 0} };
-    check_prim(!old_file, FILE_COPY_ERROR);
-    if (!new_file)
-    {
-        fclose(old_file);
-        check_prim(!new_file, FILE_COPY_ERROR);
-    }
     while (1)
     {
-        fread(&value, 4, 4, old_file);
-        if (!feof(old_file))
-            fwrite(&value, 4, 4, new_file);
-        else
+        check_prim(!fileRead(&old_file, buffer, COPY_BUFFER_SIZE, &size), FILE_COPY_ERROR);
+        if (!size)
             break;
+        check_prim(!fileWrite(&new_file, buffer, size), FILE_COPY_ERROR);
+    }
+
+    free(buffer);
+    fileClose(&old_file);
+    // The last write may only fail here
+    if (!fileClose(&new_file))
+    {
+        remove(new_filename);
+        g_primary_error = FILE_COPY_ERROR;
+        return (RESULT_ERROR);
     }
-    fclose(new_file);
-    fclose(old_file);
     return  (0);
 error:
-    remove("sdmc:/ntr.bin");
+    free(buffer);
+    fileClose(&old_file);
+    if (created)
+    {
+        fileClose(&new_file);
+        remove(new_filename);
+    }
     return (RESULT_ERROR);
 }
 
@@ -17,6 +17,7 @@ Result  bnInitParamsByFirmware(void)
     ntrConfig->HomeMenuPid = 0xF;
     bnConfig->SMPid = 3;
     bnConfig->FSPid = 0;
+    bnConfig->kernelCacheSlot = KCACHE_NONE;
     if (!isNew3DS)
     {
         ntrConfig->IoBasePad = 0xfffc6000;
@@ -42,6 +43,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xdff882cc;
             ntrConfig->ControlMemoryPatchAddr2 = 0xdff882d0;
             bnConfig->SvcPatchAddr = 0xDFF82290;
+            bnConfig->kernelCacheSlot = KCACHE_OLD90;
             bnConfig->FSPatchAddr = 0x0010ED64;
             bnConfig->SMPatchAddr = 0x00101838;
         }
@@ -53,6 +55,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xdff882D8;
             ntrConfig->ControlMemoryPatchAddr2 = 0xdff882DC;
             bnConfig->SvcPatchAddr = 0xDFF82284;
+            bnConfig->kernelCacheSlot = KCACHE_OLD96;
             bnConfig->FSPatchAddr = 0x0010EFAC;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -64,6 +67,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88468;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF8846C;
             bnConfig->SvcPatchAddr = 0xDFF82288;
+            bnConfig->kernelCacheSlot = KCACHE_OLD110;
             bnConfig->FSPatchAddr = 0x0010EED4;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -75,6 +79,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88468;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF8846C;
             bnConfig->SvcPatchAddr = 0xDFF82288;
+            bnConfig->kernelCacheSlot = KCACHE_OLD111;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -86,6 +91,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88468;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF8846C;
             bnConfig->SvcPatchAddr = 0xDFF82288;
+            bnConfig->kernelCacheSlot = KCACHE_OLD112;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -97,6 +103,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF884E4;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF884E8;
             bnConfig->SvcPatchAddr = 0xDFF82288;
+            bnConfig->kernelCacheSlot = KCACHE_OLD113;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -111,6 +118,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88514;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF88518;
             bnConfig->SvcPatchAddr = 0xDFF82288;
+            bnConfig->kernelCacheSlot = kernelVersion == SYSTEM_VERSION(2, 54, 0) ? KCACHE_OLD114 : KCACHE_OLD118;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -122,6 +130,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88574;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF88578;
             bnConfig->SvcPatchAddr = 0xDFF82288;
+            bnConfig->kernelCacheSlot = KCACHE_OLD1114;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -146,6 +155,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xdff88158;
             ntrConfig->ControlMemoryPatchAddr2 = 0xdff8815C;
             bnConfig->SvcPatchAddr = 0xDFF82264;
+            bnConfig->kernelCacheSlot = KCACHE_NEW81;
             bnConfig->FSPatchAddr = 0x0010ED64;
             bnConfig->SMPatchAddr = 0x00101838;
         }
@@ -168,6 +178,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xdff884F8;
             ntrConfig->ControlMemoryPatchAddr2 = 0xdff884FC;
             bnConfig->SvcPatchAddr = 0xDFF8226c;
+            bnConfig->kernelCacheSlot = KCACHE_NEW95;
             bnConfig->FSPatchAddr = 0x0010ED64;
             bnConfig->SMPatchAddr = 0x00101838;
         }
@@ -179,6 +190,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xdff8850C;
             ntrConfig->ControlMemoryPatchAddr2 = 0xdff88510;
             bnConfig->SvcPatchAddr = 0xDFF82268;
+            bnConfig->kernelCacheSlot = KCACHE_NEW96;
             bnConfig->FSPatchAddr = 0x0010EFAC;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -197,6 +209,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xdff884E4;
             ntrConfig->ControlMemoryPatchAddr2 = 0xdff884E8;
             bnConfig->SvcPatchAddr = 0xDFF82270;
+            bnConfig->kernelCacheSlot = KCACHE_NEW102;
             bnConfig->FSPatchAddr = 0x0010EED4;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -208,6 +221,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88598;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF8859C;
             bnConfig->SvcPatchAddr = 0xDFF8226C;
+            bnConfig->kernelCacheSlot = KCACHE_NEW110;
             bnConfig->FSPatchAddr = 0x0010EED4;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -219,6 +233,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88598;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF8859C;
             bnConfig->SvcPatchAddr = 0xDFF8226C;
+            bnConfig->kernelCacheSlot = KCACHE_NEW111;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -230,6 +245,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF88598;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF8859C;
             bnConfig->SvcPatchAddr = 0xDFF8226C;
+            bnConfig->kernelCacheSlot = KCACHE_NEW112;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -241,6 +257,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF885FC;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF88600;
             bnConfig->SvcPatchAddr = 0xDFF8226C;
+            bnConfig->kernelCacheSlot = KCACHE_NEW113;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -255,6 +272,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF8862C;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF88630;
             bnConfig->SvcPatchAddr = 0xDFF8226C;
+            bnConfig->kernelCacheSlot = KCACHE_NEW114;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
@@ -266,6 +284,7 @@ Result  bnInitParamsByFirmware(void)
             ntrConfig->ControlMemoryPatchAddr1 = 0xDFF8868C;
             ntrConfig->ControlMemoryPatchAddr2 = 0xDFF88690;
             bnConfig->SvcPatchAddr = 0xDFF8226C;
+            bnConfig->kernelCacheSlot = KCACHE_NEW1114;
             bnConfig->FSPatchAddr = 0x0010F024;
             bnConfig->SMPatchAddr = 0x0010189C;
         }
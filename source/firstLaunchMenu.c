@@ -321,7 +321,14 @@ void secondSettings(void)
 
 static void    setFiles(void)
 {
-    int     ret;
+    version_t   versions[SELECT_V36HR_MAX - SELECT_V36];
+    Result      results[SELECT_V36HR_MAX - SELECT_V36];
+    bool        upToDate[SELECT_V36HR_MAX - SELECT_V36];
+    const int   count = SELECT_V36HR_MAX - SELECT_V36;
+    bool        allUpToDate;
+    perfMode_t  prevMode;
+    int         ret;
+    int         i;
 
     if (!fileExists(bnConfig->config->binariesPath + 5))
     {
@@ -377,28 +384,35 @@ static void    setFiles(void)
     //     newAppTop(COLOR_LIMEGREEN, SKINNY, "Setting up 3.3... Done.");
     // updateUI();
 
-    newAppTop(COLOR_BLANK, SKINNY, "Setting up 3.6...");
+    // SELECT_V36 first, then every 3.6 HR binary
+    for (i = 0; i < count; i++)
+        versions[i] = SELECT_V36 + i;
+    newAppTop(COLOR_BLANK, SKINNY, "Setting up 3.6 and 3.6 HR...");
     updateUI();
-    ret = loadAndPatch(SELECT_V36);
+    prevMode = perfModeSet(PERFMODE_BOOST);
+    loadAndPatchVersions(versions, count, results, upToDate);
+    perfModeSet(prevMode);
     if (!bnConfig->isDebug)
         removeAppTop();
-    if (ret)
+
+    if (results[0])
         newAppTop(COLOR_SALMON, SKINNY, "Setting up 3.6... Error.");
+    else if (upToDate[0])
+        newAppTop(COLOR_LIMEGREEN, SKINNY, "Setting up 3.6... Up to date.");
     else
         newAppTop(COLOR_LIMEGREEN, SKINNY, "Setting up 3.6... Done.");
-    updateUI();
 
-    newAppTop(COLOR_BLANK, SKINNY, "Setting up 3.6 HR ...");
-    updateUI();
-    for (int s = SELECT_V36HR; s < SELECT_V36HR_MAX; ++s) {
-        ret = loadAndPatch(s);
-        if (ret)
-            break;
+    ret = 0;
+    allUpToDate = true;
+    for (i = 1; i < count; i++)
+    {
+        ret |= results[i];
+        allUpToDate &= upToDate[i];
     }
-    if (!bnConfig->isDebug)
-        removeAppTop();
     if (ret)
         newAppTop(COLOR_SALMON, SKINNY, "Setting up 3.6 HR... Error.");
+    else if (allUpToDate)
+        newAppTop(COLOR_LIMEGREEN, SKINNY, "Setting up 3.6 HR... Up to date.");
     else
         newAppTop(COLOR_LIMEGREEN, SKINNY, "Setting up 3.6 HR... Done.");
     updateUI();
@@ -431,7 +445,9 @@ int firstLaunch(void)
     u32         status;
     int ret = 0;
 
+    perfModeSet(PERFMODE_BOOST);
     initSettingsMenu();
+    perfModeSet(PERFMODE_NORMAL);
     appInfoDisableAutoUpdate();
     p_globalPath = bnConfig->config->binariesPath;
     p_pluginPath = bnConfig->config->pluginPath;
@@ -1,6 +1,11 @@
 #include "graphics.h"
 #include "drawableObject.h"
 #include "button.h"
+#include "config.h"
+
+#define FRAME_STATS_PERIOD  60
+
+extern bootNtrConfig_t  *bnConfig;
 
 sprite_t         *bottomSprite;
 sprite_t         *topSprite;
@@ -14,6 +19,19 @@ appInfoObject_t         *appTop;
 
 static char      appVersion[20];
 
+// Frame times in ms, averaged over FRAME_STATS_PERIOD frames
+static struct
+{
+    u64     lastTick;
+    u64     totalTicks;
+    u64     maxTicks;
+    u32     frames;
+    u32     skipped;
+    char    text[40];
+    char    perfText[40];
+    char    gpuText[48];
+}               frameStats;
+
 
 void    initUI(void)
 {
@@ -65,6 +83,12 @@ static inline void drawUITop(void)
 
     setTextColor(COLOR_BLANK);
     renderText(1.0f, 1.0f, 0.4f, 0.45f, false, appVersion, NULL);
+    if (bnConfig && bnConfig->isDebug)
+    {
+        renderText(250.0f, 1.0f, 0.4f, 0.45f, false, frameStats.text, NULL);
+        renderText(250.0f, 12.0f, 0.4f, 0.45f, false, frameStats.perfText, NULL);
+        renderText(250.0f, 23.0f, 0.4f, 0.45f, false, frameStats.gpuText, NULL);
+    }
     drawAppInfo(appTop);
 }
 
@@ -76,23 +100,95 @@ static inline void drawUIBottom(void)
     drawAppInfo(appStatus);
 }
 
-int   updateUI(void)
+static void updateFrameStats(void)
 {
-    hidScanInput();
+    drawStats_t gpu;
+    u64         tick;
+    u64         delta;
+
+    tick = svcGetSystemTick();
+    delta = frameStats.lastTick ? tick - frameStats.lastTick : 0;
+    frameStats.lastTick = tick;
+    frameStats.totalTicks += delta;
+    if (delta > frameStats.maxTicks)
+        frameStats.maxTicks = delta;
+    if (++frameStats.frames < FRAME_STATS_PERIOD)
+        return;
+    snprintf(frameStats.text, sizeof(frameStats.text), "%.1fms max %.1fms skip %lu",
+        frameStats.totalTicks / (float)frameStats.frames / CPU_TICKS_PER_MSEC,
+        frameStats.maxTicks / (float)CPU_TICKS_PER_MSEC, frameStats.skipped);
+    perfModeStats(frameStats.perfText, sizeof(frameStats.perfText));
+    drawGetStats(&gpu);
+    snprintf(frameStats.gpuText, sizeof(frameStats.gpuText), "cmd %luB draw %lu tex %lu env %lu",
+        gpu.cmdBufBytes, gpu.drawCalls, gpu.texBinds, gpu.envChanges);
+    frameStats.totalTicks = frameStats.maxTicks = 0;
+    frameStats.frames = frameStats.skipped = 0;
+}
+
+static int  drawUI(bool skipIfBusy)
+{
+    appInfoFlushQueue();
+    if (!drawBeginFrame(skipIfBusy))
+    {
+        frameStats.skipped++;
+        return (0);
+    }
     drawUITop();
     drawUIBottom();
     updateScreen();
+    updateFrameStats();
     return (1);
 }
 
-void    addTopObject(void *object)
+int   updateUI(void)
+{
+    // Only the main thread draws, the others go through appInfo's queue
+    if (threadGetCurrent() != NULL)
+        return (0);
+    hidScanInput();
+    return (drawUI(false));
+}
+
+/*
+** Paced UI loop: func runs at fps (30 or 60) and a frame is only drawn when
+** the GPU is done with the previous one. func sees the keys of this frame.
+** Without func, runs until the app is asked to close.
+** Returns false when the loop ended because the app is closing.
+*/
+bool    runUILoop(u32 fps, uiFrameFunc_t func, void *arg)
+{
+    bool    running;
+
+    C3D_FrameRate(fps);
+    while ((running = aptMainLoop()))
+    {
+        hidScanInput();
+        if (func && !func(arg))
+            break;
+        drawUI(true);
+    }
+    C3D_FrameRate(60);
+    return (running);
+}
+
+u32     addTopObject(void *object)
+{
+    return (addObjectToScreen(topScreen, object));
+}
+
+u32     addBottomObject(void *object)
+{
+    return (addObjectToScreen(botScreen, object));
+}
+
+void    *removeTopObject(u32 handle)
 {
-    addObjectToScreen(topScreen, object);
+    return (removeObjectFromScreen(topScreen, handle));
 }
 
-void    addBottomObject(void *object)
+void    *removeBottomObject(u32 handle)
 {
-    addObjectToScreen(botScreen, object);
+    return (removeObjectFromScreen(botScreen, handle));
 }
 
 void    changeTopFooter(sprite_t *footer)
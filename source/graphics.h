@@ -7,11 +7,17 @@
 
 #define STACKSIZE 0x1000
 
+// Called once per frame by runUILoop, return false to leave the loop
+typedef bool(*uiFrameFunc_t)(void *arg);
+
 void    initUI(void);
 void    exitUI(void);
 int     updateUI(void);
-void    addTopObject(void *object);
-void    addBottomObject(void *object);
+bool    runUILoop(u32 fps, uiFrameFunc_t func, void *arg);
+u32     addTopObject(void *object);
+u32     addBottomObject(void *object);
+void    *removeTopObject(u32 handle);
+void    *removeBottomObject(u32 handle);
 void    changeTopFooter(sprite_t *footer);
 void    changeTopHeader(sprite_t *header);
 void    changeBottomFooter(sprite_t *footer);
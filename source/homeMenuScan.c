@@ -0,0 +1,99 @@
+#include "homeMenuScan.h"
+#include <string.h>
+
+#define PROLOGUE_WINDOW 0x1000
+
+static const u32    patFsRead[] = { 0x080200C2 };
+static const u32    patFsHandle[] = { 0x08a067f9 };
+static const u32    patCartUpdate[] = { 0x00070042 };
+static const u32    patStartApplet[] = { 0x00150140 };
+static const u32    patSwapBuffer1[] = { 0xe1833000, 0xe2044cff, 0xe3c33cff, 0xe1833004, 0xe1824f93 };
+static const u32    patSwapBuffer2[] = { 0xe8830e60, 0xee078f9a, 0xe3a03001, 0xe7902104 };
+static const u32    patSwapBuffer3[] = { 0xee076f9a, 0xe3a02001, 0xe7901104, 0xe1911f9f, 0xe3c110ff };
+
+static const struct
+{
+    const u32   *pattern;
+    u32         count;
+}   homeMenuSigs[HMSIG_COUNT] =
+{
+    [HMSIG_FS_READ] = { patFsRead, 1 },
+    [HMSIG_FS_HANDLE] = { patFsHandle, 1 },
+    [HMSIG_CARD_UPDATE] = { patCartUpdate, 1 },
+    [HMSIG_START_APPLET] = { patStartApplet, 1 },
+    [HMSIG_SWAP_BUFFER1] = { patSwapBuffer1, 5 },
+    [HMSIG_SWAP_BUFFER2] = { patSwapBuffer2, 4 },
+    [HMSIG_SWAP_BUFFER3] = { patSwapBuffer3, 5 },
+};
+
+const char  *homeMenuSigNames[HMSIG_COUNT] =
+{
+    "FSRead",
+    "FSUHandle",
+    "CardUpdateInit",
+    "AptStartApplet",
+    "SwapBuffer1",
+    "SwapBuffer2",
+    "SwapBuffer3"
+};
+
+static u32  resolveFunction(const u8 *text, u32 textBase, const prologueIndex_t *index,
+                            const signature_t *sig)
+{
+    u32     prologue;
+
+    if (!sig->hits || !prologueLookup(index, text, sig->offset, PROLOGUE_WINDOW, 0, &prologue))
+        return (0);
+    return (textBase + prologue);
+}
+
+void    homeMenuSignatures(signature_t *sigs)
+{
+    u32     i;
+
+    memset(sigs, 0, HMSIG_COUNT * sizeof(signature_t));
+    for (i = 0; i < HMSIG_COUNT; i++)
+    {
+        sigs[i].pattern = homeMenuSigs[i].pattern;
+        sigs[i].count = homeMenuSigs[i].count;
+    }
+}
+
+void    homeMenuResolve(const u8 *text, u32 textBase, const prologueIndex_t *index,
+                        const signature_t *sigs, homeMenuScan_t *scan)
+{
+    u32     i;
+
+    memset(scan, 0, sizeof(*scan));
+    for (i = 0; i < HMSIG_COUNT; i++)
+        scan->hits[i] = sigs[i].hits;
+
+    scan->fsReadAddr = resolveFunction(text, textBase, index, &sigs[HMSIG_FS_READ]);
+    // The handle address is the literal right before the IPC header
+    if (sigs[HMSIG_FS_HANDLE].hits && sigs[HMSIG_FS_HANDLE].offset >= 4)
+        scan->fsUHandleAddr = *(const u32 *)(text + sigs[HMSIG_FS_HANDLE].offset - 4);
+    scan->cardUpdateInitAddr = resolveFunction(text, textBase, index, &sigs[HMSIG_CARD_UPDATE]);
+    scan->aptStartAppletAddr = resolveFunction(text, textBase, index, &sigs[HMSIG_START_APPLET]);
+
+    // Swap buffer patterns are tried in order, not by position
+    for (i = HMSIG_SWAP_BUFFER1; i <= HMSIG_SWAP_BUFFER3; i++)
+    {
+        if (!sigs[i].hits)
+            continue;
+        scan->swapBufferSig = i;
+        scan->menuInjectAddr = resolveFunction(text, textBase, index, &sigs[i]);
+        break;
+    }
+}
+
+void    homeMenuScan(const u8 *text, u32 size, u32 textBase, homeMenuScan_t *scan, bool countAll)
+{
+    signature_t     sigs[HMSIG_COUNT];
+    prologueIndex_t index;
+
+    memset(&index, 0, sizeof(index));
+    homeMenuSignatures(sigs);
+    scanSignaturesIndexed(text, size, sigs, HMSIG_COUNT, countAll, &index);
+    homeMenuResolve(text, textBase, &index, sigs, scan);
+    prologueIndexFree(&index);
+}
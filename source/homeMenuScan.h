@@ -0,0 +1,50 @@
+#ifndef HOMEMENUSCAN_H
+#define HOMEMENUSCAN_H
+
+#include "scanner.h"
+
+/*
+** Signatures used to locate NTR's hooks in the Home Menu .text, shared by
+** analyseHomeMenu() and tools/hmscan.
+*/
+
+#define HOMEMENU_TEXT_BASE  0x00100000
+
+typedef enum    homeMenuSig_e
+{
+    HMSIG_FS_READ = 0,
+    HMSIG_FS_HANDLE,
+    HMSIG_CARD_UPDATE,
+    HMSIG_START_APPLET,
+    HMSIG_SWAP_BUFFER1,
+    HMSIG_SWAP_BUFFER2,
+    HMSIG_SWAP_BUFFER3,
+    HMSIG_COUNT
+}               homeMenuSig_t;
+
+typedef struct  homeMenuScan_s
+{
+    u32         fsReadAddr;
+    u32         fsUHandleAddr;
+    u32         cardUpdateInitAddr;
+    u32         aptStartAppletAddr;
+    u32         menuInjectAddr;
+    u32         hits[HMSIG_COUNT];  // matches per signature
+    u32         swapBufferSig;      // signature used for menuInjectAddr
+}               homeMenuScan_t;
+
+extern const char   *homeMenuSigNames[HMSIG_COUNT];
+
+/*
+** text is a copy or mapping of the Home Menu .text loaded at textBase.
+** Addresses that can't be resolved are left to 0. With countAll every
+** match is counted, which is only needed to check signatures offline.
+*/
+void    homeMenuScan(const u8 *text, u32 size, u32 textBase, homeMenuScan_t *scan, bool countAll);
+
+// The two halves of homeMenuScan, for callers running the scan themselves
+void    homeMenuSignatures(signature_t *sigs);
+void    homeMenuResolve(const u8 *text, u32 textBase, const prologueIndex_t *index,
+                        const signature_t *sigs, homeMenuScan_t *scan);
+
+#endif
@@ -1,5 +1,6 @@
 #include "main.h"
 #include "config.h"
+#include "homeMenuScan.h"
 
 extern ntrConfig_t      *ntrConfig;
 extern bootNtrConfig_t  *bnConfig;
@@ -331,88 +332,29 @@ error:
 }*/
 
 
-#define MAX_MAP_SIZE (0x00400000)
-
-u32     translateAddr(u32 mappedAddr)
-{
-    if (mappedAddr < 0x0f000000)
-    {
-        return (0);
-    }
-    return (mappedAddr - 0x0f000000 + 0x00100000);
-}
-
-u32     locateSwapBuffer(u32 startAddr, u32 endAddr)
+Result  analyseHomeMenu(processText_t *text, signature_t *sigs)
 {
-
-    static u32 pat[] = { 0xe1833000, 0xe2044cff, 0xe3c33cff, 0xe1833004, 0xe1824f93 };
-    static u32 pat2[] = { 0xe8830e60, 0xee078f9a, 0xe3a03001, 0xe7902104 };
-    static u32 pat3[] = { 0xee076f9a, 0xe3a02001, 0xe7901104, 0xe1911f9f, 0xe3c110ff};
-
-    u32 addr = searchBytes(startAddr, endAddr, (u8 *)pat, sizeof(pat), 4);
-    if (!addr)
-    {
-        addr = searchBytes(startAddr, endAddr, (u8 *)pat2, sizeof(pat2), 4);
-    }
-    if (!addr)
-    {
-        addr = searchBytes(startAddr, endAddr, (u8 *)pat3, sizeof(pat3), 4);
-    }
-    return (findNearestSTMFD(startAddr, addr));
-}
-
-static const u8 patFsRead[] = { 0xC2, 0x00, 0x02, 0x08 };
-static const u8 patFsHandle[] = { 0xf9, 0x67, 0xa0, 0x08 };
-static const u8 patCartUpdate[] = { 0x42, 0x00, 0x07, 0x00 };
-static const u8 patStartApplet[] = { 0x40, 0x01, 0x15, 0x00 };
-
-Result  analyseHomeMenu(void)
-{
-    Result  ret = 0;
-    u32     text = 0x0f000000;
-    u32     mapSize = MAX_MAP_SIZE;
-
-    MemInfo     meminfo;
-    PageInfo    pageinfo;
-
-    memset(&meminfo, 0, sizeof(meminfo));
-    memset(&pageinfo, 0, sizeof(pageinfo));
+    homeMenuScan_t  scan;
 
     newAppTopDebug(DEFAULT_COLOR, SKINNY, "Starting analysis...");
+    newAppTopDebug(DEFAULT_COLOR, SKINNY, "text: %08x, size: %08x", text->start, text->size);
 
-    ret = svcQueryMemory(&meminfo, &pageinfo, (u32)text);
-    if(R_FAILED(ret))
-    {
-        newAppTopDebug(RED, SKINNY, "svcQueryMemory failed: 0x%08x", (unsigned int)ret);
-        return (RESULT_ERROR);
-    }
-
-    if(meminfo.size < mapSize)
-        mapSize = meminfo.size;
+    homeMenuResolve(text->text, text->start, &text->index, sigs, &scan);
 
-    newAppTopDebug(DEFAULT_COLOR, SKINNY, "mapSize: %08x, size: %08x", mapSize, meminfo.size);
-
-
-    ntrConfig->HomeFSReadAddr = translateAddr(findNearestSTMFD(text ,searchBytes(text, text + mapSize, (u8 *)patFsRead, sizeof(patFsRead), 4)));
+    ntrConfig->HomeFSReadAddr = scan.fsReadAddr;
     newAppTopDebug(DEFAULT_COLOR, SKINNY, "HomeFSReadAddr: %08x", ntrConfig->HomeFSReadAddr);
 
-
-    u32 t = searchBytes(text, text + mapSize, (u8 *)patFsHandle, sizeof(patFsHandle), 4);
-    if (t > 0)
-    {
-        ntrConfig->HomeFSUHandleAddr = *(u32*)(t - 4);
-    }
+    if (scan.fsUHandleAddr)
+        ntrConfig->HomeFSUHandleAddr = scan.fsUHandleAddr;
     newAppTopDebug(DEFAULT_COLOR, SKINNY,"HomeFSUHandleAddr: %08x", ntrConfig->HomeFSUHandleAddr);
 
-
-    ntrConfig->HomeCardUpdateInitAddr = translateAddr(findNearestSTMFD(text, searchBytes(text, text + mapSize, (u8 *)patCartUpdate, sizeof(patCartUpdate), 4)));
+    ntrConfig->HomeCardUpdateInitAddr = scan.cardUpdateInitAddr;
     newAppTopDebug(DEFAULT_COLOR, SKINNY,"HomeCardUpdateInitAddr: %08x", ntrConfig->HomeCardUpdateInitAddr);
 
-
-    ntrConfig->HomeAptStartAppletAddr = translateAddr(findNearestSTMFD(text, searchBytes(text, text + mapSize, (u8 *)patStartApplet, sizeof(patStartApplet), 4)));
+    ntrConfig->HomeAptStartAppletAddr = scan.aptStartAppletAddr;
     newAppTopDebug(DEFAULT_COLOR, SKINNY,"HomeAptStartAppletAddr: %08x", ntrConfig->HomeAptStartAppletAddr);
 
-    ntrConfig->HomeMenuInjectAddr = translateAddr(locateSwapBuffer(text, text + mapSize));
+    ntrConfig->HomeMenuInjectAddr = scan.menuInjectAddr;
     newAppTopDebug(DEFAULT_COLOR, SKINNY,"HomeMenuInjectAddr: %08x", ntrConfig->HomeMenuInjectAddr);
 
     newAppTopDebug(GREEN, SKINNY, "Analysis finished.");
@@ -420,13 +362,33 @@ Result  analyseHomeMenu(void)
     return (0);
 }
 
+static Result   paramsFromText(processText_t *text, signature_t *sigs)
+{
+    Result  ret;
+
+    ret = analyseHomeMenu(text, sigs);
+    closeProcessText(text);
+    ntrConfig->HomeMenuVersion = SYSTEM_VERSION(1, 0, 0);
+    return (ret);
+}
+
 Result bnInitParamsByHomeMenu(void)
 {
-    u32     hProcess = 0;
-    u32     ret;
+    processText_t   text;
+    signature_t     sigs[HMSIG_COUNT];
+    u32             ret;
 
+    homeMenuSignatures(sigs);
 again:
-    ret = svcOpenProcess(&hProcess, ntrConfig->HomeMenuPid);
+    ret = scanProcessText(ntrConfig->HomeMenuPid, sigs, HMSIG_COUNT, &text);
+    // .text was found but couldn't be mapped, retrying won't help
+    if (ret && text.size)
+    {
+        newAppStatus(DEFAULT_COLOR, TINY | CENTER, "Mapping failed !");
+        newAppStatus(DEFAULT_COLOR, TINY | CENTER, "%08X", ret);
+        updateUI();
+        return (RESULT_ERROR);
+    }
     if (ret)
     {
         newAppStatus(DEFAULT_COLOR, TINY | CENTER, "An error occurred");
@@ -438,21 +400,18 @@ again:
         updateUI();
         goto again;
     }
+    return (paramsFromText(&text, sigs));
+}
 
-    //Map .text+0(0x00100000) up to 0x40000, to vaddr 0x0f000000 in the current process.
-    ret = svcMapProcessMemory(hProcess, 0x0f000000, MAX_MAP_SIZE);
-    if (ret != 0)
-    {
-        newAppStatus(DEFAULT_COLOR, TINY | CENTER, "Mapping failed !");
-        newAppStatus(DEFAULT_COLOR, TINY | CENTER, "%08X", ret);
-        updateUI();
-        goto final;
-    }
-    ret = analyseHomeMenu();
-    svcUnmapProcessMemory(hProcess, 0x0f000000, MAX_MAP_SIZE);
-    svcCloseHandle(hProcess);
-    ntrConfig->HomeMenuVersion = SYSTEM_VERSION(1, 0, 0);
-    return (ret);
-final:
-    return (RESULT_ERROR);
-}
\ No newline at end of file
+// Single silent attempt for the boot prefetch, bnInitParamsByHomeMenu does
+// the retries and the messages if this one failed
+Result bnTryParamsByHomeMenu(void)
+{
+    processText_t   text;
+    signature_t     sigs[HMSIG_COUNT];
+
+    homeMenuSignatures(sigs);
+    if (scanProcessText(ntrConfig->HomeMenuPid, sigs, HMSIG_COUNT, &text))
+        return (RESULT_ERROR);
+    return (paramsFromText(&text, sigs));
+}
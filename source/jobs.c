@@ -0,0 +1,204 @@
+#include "jobs.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __3DS__
+
+#include <3ds.h>
+
+typedef Thread      jobThread_t;
+typedef LightLock   jobLock_t;
+typedef CondVar     jobCond_t;
+
+#define lockInit(l)         LightLock_Init(l)
+#define lockAcquire(l)      LightLock_Lock(l)
+#define lockRelease(l)      LightLock_Unlock(l)
+#define condInit(c)         CondVar_Init(c)
+#define condWait(c, l)      CondVar_Wait(c, l)
+#define condSignal(c)       CondVar_Signal(c)
+#define condBroadcast(c)    CondVar_Broadcast(c)
+
+#else
+
+#include <pthread.h>
+
+typedef pthread_t       jobThread_t;
+typedef pthread_mutex_t jobLock_t;
+typedef pthread_cond_t  jobCond_t;
+
+#define lockInit(l)         pthread_mutex_init(l, NULL)
+#define lockAcquire(l)      pthread_mutex_lock(l)
+#define lockRelease(l)      pthread_mutex_unlock(l)
+#define condInit(c)         pthread_cond_init(c, NULL)
+#define condWait(c, l)      pthread_cond_wait(c, l)
+#define condSignal(c)       pthread_cond_signal(c)
+#define condBroadcast(c)    pthread_cond_broadcast(c)
+
+#endif
+
+static jobThread_t  workers[JOBS_MAX_WORKERS];
+static int          workerCount = 0;
+static jobLock_t    queueLock;
+static jobCond_t    queueCond;
+static jobCond_t    doneCond;
+static job_t        *queueHead = NULL;
+static job_t        *queueTail = NULL;
+static bool         quit = false;
+
+static void runJob(job_t *job)
+{
+    job->func(job->arg, &job->progress);
+    lockAcquire(&queueLock);
+    job->progress = 100;
+    job->state = JOB_DONE;
+    condBroadcast(&doneCond);
+    lockRelease(&queueLock);
+}
+
+static void workerMain(void *arg)
+{
+    job_t   *job;
+
+    (void)arg;
+    while (1)
+    {
+        lockAcquire(&queueLock);
+        while (!queueHead && !quit)
+            condWait(&queueCond, &queueLock);
+        job = queueHead;
+        if (!job)
+        {
+            lockRelease(&queueLock);
+            break;
+        }
+        queueHead = job->next;
+        if (!queueHead)
+            queueTail = NULL;
+        job->state = JOB_RUNNING;
+        lockRelease(&queueLock);
+        runJob(job);
+    }
+}
+
+#ifdef __3DS__
+
+static bool startWorker(jobThread_t *thread)
+{
+    s32     priority = 0x30;
+    bool    isNew3DS = false;
+
+    // Run just below the main thread so SD I/O and UI stay responsive,
+    // and prefer the New 3DS extra core when it is available.
+    svcGetThreadPriority(&priority, CUR_THREAD_HANDLE);
+    APT_CheckNew3DS(&isNew3DS);
+    *thread = NULL;
+    if (isNew3DS)
+        *thread = threadCreate(workerMain, NULL, JOBS_STACK_SIZE, priority + 1, 2, false);
+    if (!*thread)
+        *thread = threadCreate(workerMain, NULL, JOBS_STACK_SIZE, priority + 1, -2, false);
+    return (*thread != NULL);
+}
+
+static void joinWorker(jobThread_t thread)
+{
+    threadJoin(thread, U64_MAX);
+    threadFree(thread);
+}
+
+#else
+
+static void *pthreadMain(void *arg)
+{
+    workerMain(arg);
+    return (NULL);
+}
+
+static bool startWorker(jobThread_t *thread)
+{
+    return (pthread_create(thread, NULL, pthreadMain, NULL) == 0);
+}
+
+static void joinWorker(jobThread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+
+#endif
+
+int     jobsInit(int count)
+{
+    if (workerCount)
+        return (workerCount);
+    if (count > JOBS_MAX_WORKERS)
+        count = JOBS_MAX_WORKERS;
+    lockInit(&queueLock);
+    condInit(&queueCond);
+    condInit(&doneCond);
+    queueHead = queueTail = NULL;
+    quit = false;
+    while (workerCount < count && startWorker(&workers[workerCount]))
+        workerCount++;
+    return (workerCount);
+}
+
+void    jobsExit(void)
+{
+    int     i;
+
+    if (!workerCount)
+        return;
+    lockAcquire(&queueLock);
+    quit = true;
+    condBroadcast(&queueCond);
+    lockRelease(&queueLock);
+    for (i = 0; i < workerCount; i++)
+        joinWorker(workers[i]);
+    workerCount = 0;
+}
+
+int     jobsWorkerCount(void)
+{
+    return (workerCount);
+}
+
+void    jobSubmit(job_t *job, jobFunc_t func, void *arg)
+{
+    job->func = func;
+    job->arg = arg;
+    job->progress = 0;
+    job->next = NULL;
+
+    // Without workers the job simply runs on the caller's thread
+    if (!workerCount)
+    {
+        job->state = JOB_RUNNING;
+        func(arg, &job->progress);
+        job->progress = 100;
+        job->state = JOB_DONE;
+        return;
+    }
+    lockAcquire(&queueLock);
+    job->state = JOB_PENDING;
+    if (queueTail)
+        queueTail->next = job;
+    else
+        queueHead = job;
+    queueTail = job;
+    condSignal(&queueCond);
+    lockRelease(&queueLock);
+}
+
+bool    jobIsDone(job_t *job)
+{
+    return (job->state == JOB_DONE);
+}
+
+void    jobWait(job_t *job)
+{
+    if (!workerCount || job->state == JOB_IDLE)
+        return;
+    lockAcquire(&queueLock);
+    while (job->state != JOB_DONE)
+        condWait(&doneCond, &queueLock);
+    lockRelease(&queueLock);
+}
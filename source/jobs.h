@@ -0,0 +1,48 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __3DS__
+#include <3ds/types.h>
+#else
+typedef uint32_t  u32;
+#endif
+
+/*
+** Minimal job system used to run CPU bound work (binary patching, scans)
+** on a worker thread while the main thread keeps doing I/O and UI.
+** Built on libctru threads on the console and on pthreads on the host.
+*/
+
+#define JOBS_MAX_WORKERS    2
+#define JOBS_STACK_SIZE     0x4000
+
+typedef void(*jobFunc_t)(void *arg, volatile u32 *progress);
+
+typedef enum    jobState_e
+{
+    JOB_IDLE = 0,
+    JOB_PENDING,
+    JOB_RUNNING,
+    JOB_DONE
+}               jobState_t;
+
+typedef struct  job_s
+{
+    jobFunc_t       func;
+    void            *arg;
+    volatile u32    progress; // 0 to 100, written by the worker
+    volatile u32    state;
+    struct job_s    *next;
+}               job_t;
+
+int     jobsInit(int workerCount);
+void    jobsExit(void);
+int     jobsWorkerCount(void);
+void    jobSubmit(job_t *job, jobFunc_t func, void *arg);
+bool    jobIsDone(job_t *job);
+void    jobWait(job_t *job);
+
+#endif
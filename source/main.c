@@ -11,6 +11,11 @@ char              *g_secondary_error = NULL;
 char              *g_third_error = NULL;
 bool              g_exit = false;
 
+static bool waitForKeyFrame(void *arg)
+{
+    return (hidKeysDown() == 0);
+}
+
 int main(void)
 {
     u32         keys;
@@ -23,8 +28,12 @@ int main(void)
     drawInit();
     romfsInit();
     ptmSysmInit();
+    perfModeInit();
 
+    // Decoding and tiling the sprites is CPU bound
+    perfModeSet(PERFMODE_BOOST);
     initUI();
+    perfModeSet(PERFMODE_NORMAL);
     hidScanInput();
     keys = (hidKeysDown() | hidKeysHeld());
     debug = 0;
@@ -36,6 +45,9 @@ int main(void)
         g_exit = true;
         goto exit;
     }
+    // Patch again what a crash left incomplete, only reads the stamps when
+    // all is fine
+    repairBinaries();
 
     // If keys == X or if config say we should check an update
     /*if (keys & KEY_X || bnConfig->checkForUpdate)
@@ -60,7 +72,9 @@ int main(void)
 
     kernelVersion = osGetKernelVersion();
     waitAllKeysReleased();
+    perfModeSet(PERFMODE_BOOST);
     initMainMenu();
+    perfModeSet(PERFMODE_NORMAL);
     ret = mainMenu();
     if (ret == 2) goto waitForExit;
     if (!g_exit)
@@ -78,10 +92,7 @@ int main(void)
             updateUI();
 
             g_exit = true;
-            while (aptMainLoop())
-            {
-                updateUI();
-            }
+            runUILoop(30, NULL, NULL);
             goto exit;
 
         #else
@@ -123,16 +134,10 @@ waitForExit:
             newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "return to HomeMenu");
         else
             newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "reboot");
-        while (aptMainLoop())
-        {
-            updateUI();
-            hidScanInput();
-            keys = hidKeysDown();
-            if (keys)
-                break;
-        }
+        runUILoop(30, waitForKeyFrame, NULL);
     }
 exit:
+    perfModeRestore();
     if (boot_success)
         configExit();
     exitMainMenu();
@@ -11,6 +11,8 @@
 #include <3ds.h>
 #include "graphics.h"
 #include "mysvcs.h"
+#include "ntrPatch.h"
+#include "scanner.h"
 
 
 #if EXTENDEDMODE
@@ -67,6 +69,7 @@ typedef uint8_t   u8;
 #define NTR_ALREADY_LAUNCHED        (char *)s_error[18]
 #define CUSTOM_PM_PATCH_FAIL        (char *)s_error[19]
 #define LUMA_3GX_NOT_INSTALLED      (char *)s_error[20]
+#define NTR_BINARY_CORRUPTED        (char *)s_error[21]
 
 static const char * const s_error[] =
 {
@@ -90,7 +93,8 @@ static const char * const s_error[] =
     "LOAD_AND_EXECUTE",
     "NTR is already running",
     "CUSTOM_PM_PATCH_FAIL",
-    "Luma3DS 3GX\nnot installed"
+    "Luma3DS 3GX\nnot installed",
+    "NTR binary corrupted\nrestart to repair it"
 };
 
 typedef struct  updateData_s
@@ -99,30 +103,31 @@ typedef struct  updateData_s
     u32             responseCode;
 }               updateData_t;
 
-typedef void(*funcType)();
-typedef struct  s_BLOCK
+// .text of another process mapped in ours, see scanProcessText
+typedef struct  processText_s
 {
-    u32         buffer[4];
-}               t_BLOCK;
-
-typedef enum    version_e
+    Handle          handle;
+    u32             start;      // .text address in the process
+    u32             size;
+    const u8        *text;      // local mapping
+    prologueIndex_t index;
+}               processText_t;
+
+// Bump allocator over one linear memory block, freed all at once
+typedef struct  linearArena_s
 {
-    // V32 = 0,
-    // V33 = 1,
-    SELECT_V36 = 2,
-    SELECT_V36HR = 3,
-    SELECT_V36HR_MENU,
-    SELECT_V36HR_PM,
-    SELECT_V36HR_NWM,
-    SELECT_V36HR_GAME,
-    SELECT_V36HR_MAX
-}               version_t;
+    u8              *base;
+    u32             size;
+    u32             used;
+    bool            protectFailed;  // rtCheckRemoteMemoryRegionSafeForWrite
+}               linearArena_t;
+
+typedef void(*funcType)();
 
 /*
 ** misc.s
 */
 void    kFlushDataCache(void *, u32);
-void    flushDataCache(void);
 void    FlushAllCache(void);
 void    InvalidateEntireInstructionCache(void);
 void    InvalidateEntireDataCache(void);
@@ -149,7 +154,6 @@ extern bool     g_exit;
 bool    abort_and_exit(void);
 void    wait_keys_clear(void);
 u32     getCurrentProcessHandle(void);
-void    flushDataCache(void);
 void    doFlushCache(void);
 void    doStallCpu(void);
 void    doWait(void);
@@ -158,6 +162,7 @@ void    strInsert(char *dst, char *src, int index);
 void    strncpyFromTail(char *dst, char *src, int nb);
 bool    inputPathKeyboard(char *dst, char *hintText, char *initialText, int bufSize);
 void    waitAllKeysReleased(void);
+void    waitMs(u32 ms);
 void    wait(int seconds);
 void    debug(char *str, int seconds);
 /*
@@ -167,25 +172,59 @@ bool        isPluginLoaderLuma();
 Result      bnPatchAccessCheck(void);
 Result      bnLoadAndExecuteNTR(void);
 Result      bnBootNTR(void);
+void        bnPrefetchBoot(void);
+void        bnCancelPrefetch(void);
 // void        launchNTRDumpMode(void);
 
+/*
+** perfMode.c
+*/
+typedef enum
+{
+    PERFMODE_NORMAL = 0,    // 268MHz, L2 as set by the exheader
+    PERFMODE_BOOST,         // 804MHz and L2 on New 3DS
+    PERFMODE_COUNT
+}           perfMode_t;
+
+void        perfModeInit(void);
+perfMode_t  perfModeSet(perfMode_t mode);
+void        perfModeRestore(void);
+void        perfModeStats(char *dst, u32 size);
+
 /*
 ** pathPatcher.c
 */
-Result        loadAndPatch(version_t version);
+Result        loadAndPatch(version_t version, bool *upToDate);
+Result        loadAndPatchVersions(const version_t *versions, int count, Result *results, bool *upToDate);
+Result        repairBinaries(void);
 
 /*
 ** memory_functions.c
 */
+typedef enum
+{
+    COPY_BACKEND_AUTO = 0,  // DMA from REMOTECOPY_DMA_MIN_SIZE, mapped below
+    COPY_BACKEND_MAPPED,    // map both sides and memcpy
+    COPY_BACKEND_DMA,       // inter-process DMA, mapped copy if it can't run
+    COPY_BACKEND_COUNT
+}           copyBackend_t;
+
+void    syncWrittenRange(void *addr, u32 size);
 u32     protectRemoteMemory(Handle hProcess, u32 addr, u32 size);
 u32     copyRemoteMemory(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size);
+u32     copyRemoteMemoryWith(copyBackend_t backend, Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size);
 u32     patchRemoteProcess(u32 pid, u32 addr, u8 *buf, u32 len);
 u32     rtAlignToPageSize(u32 size);
 u32     rtGetPageOfAddress(u32 addr);
 u32     rtCheckRemoteMemoryRegionSafeForWrite(Handle hProcess, u32 addr, u32 size);
-u32     memfind(u8 *startPos, u32 size, const void *pattern, u32 patternSize);
-u32     findNearestSTMFD(u32 base, u32 pos);
 u32     searchBytes(u32 startAddr, u32 endAddr, u8* pat, int patlen, int step);
+Result  scanProcessText(u32 pid, signature_t *sigs, u32 count, processText_t *text);
+u32     processTextAddr(const processText_t *text, const signature_t *sig);
+u32     processTextFunction(const processText_t *text, const signature_t *sig, u32 window, u32 match);
+void    closeProcessText(processText_t *text);
+bool    linearArenaInit(linearArena_t *arena, u32 size);
+void    *linearArenaAlloc(linearArena_t *arena, u32 size, u32 align);
+void    linearArenaFree(linearArena_t *arena);
 
 /*
 ** firmware.c
@@ -201,6 +240,7 @@ void    kernelCallback(void);
 ** homemenu.c
 */
 Result  bnInitParamsByHomeMenu(void);
+Result  bnTryParamsByHomeMenu(void);
 
 /*
 ** updater.c
@@ -5,6 +5,7 @@
 #include <time.h>
 
 extern bootNtrConfig_t  *bnConfig;
+extern bool             g_exit;
 
 // static button_t         *V32Button;
 // static button_t         *V33Button;
@@ -100,13 +101,53 @@ static const char * versionString[] =
     "3.6 HR"
 };
 
-int     mainMenu(void)
+typedef struct  countdown_s
 {
     time_t      baseTime;
     int         timer;
     int         timerBak;
-    u32         keys;
     bool        noTimer;
+    bool        aborted;
+}               countdown_t;
+
+static bool mainMenuFrame(void *arg)
+{
+    countdown_t *cd = (countdown_t *)arg;
+    u32         keys;
+
+    if (userTouch)
+        return (false);
+    keys = hidKeysDown() | hidKeysHeld();
+    // if (keys == (KEY_L | KEY_R | KEY_X | KEY_DUP)) goto dumpMode;
+    if (keys && !bnConfig->isMode3 && !cd->noTimer)
+    {
+        cd->noTimer = true;
+        removeAppStatus();
+    }
+    if (abort_and_exit())
+    {
+        cd->aborted = true;
+        return (false);
+    }
+    if (!cd->noTimer)
+    {
+        cd->timer -= (time(NULL) - cd->baseTime);
+        if (cd->timer != cd->timerBak)
+        {
+            cd->timerBak = cd->timer;
+            removeAppStatus();
+            newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "Loading %s in %d", versionString[bnConfig->versionToLaunch], cd->timerBak);
+            cd->baseTime = time(NULL);
+        }
+        if (cd->timer <= 0)
+            return (false);
+    }
+    return (true);
+}
+
+int     mainMenu(void)
+{
+    countdown_t cd;
 
     static bool first = true;
     if (first && !bnConfig->isMode3) {
@@ -122,51 +163,35 @@ int     mainMenu(void)
     }
 
     waitAllKeysReleased();
-    if (!bnConfig->isMode3 && !bnConfig->config->flags) noTimer = true;
-    else noTimer = false;
+    memset(&cd, 0, sizeof(cd));
+    if (!bnConfig->isMode3 && !bnConfig->config->flags) cd.noTimer = true;
+    else cd.noTimer = false;
     appInfoDisableAutoUpdate();
-    if (!noTimer)
+    if (!cd.noTimer)
     {
-        timerBak = timer = TIMER;
-        newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "Loading %s in %d", versionString[bnConfig->versionToLaunch], timerBak);
-        baseTime = time(NULL);
+        cd.timerBak = cd.timer = TIMER;
+        newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "Loading %s in %d", versionString[bnConfig->versionToLaunch], cd.timerBak);
+        cd.baseTime = time(NULL);
         updateUI();
     }
-    keys = 0;
 
-    while (userTouch == false)
+    // Get the boot going for the shown version while the user decides
+    bnPrefetchBoot();
+    // Closing the app from HOME is an abort too, never a boot
+    if (!runUILoop(60, mainMenuFrame, &cd))
     {
-        keys = hidKeysDown() | hidKeysHeld();
-        // if (keys == (KEY_L | KEY_R | KEY_X | KEY_DUP)) goto dumpMode;
-        if (keys && !bnConfig->isMode3)
-        {
-            noTimer = true;
-            removeAppStatus();
-            updateUI();
-        }
-        if (abort_and_exit()) goto abort;
-        if (!noTimer)
-        {
-            timer -= (time(NULL) - baseTime);
-            if (timer != timerBak)
-            {
-                timerBak = timer;
-                removeAppStatus();
-                newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "Loading %s in %d", versionString[bnConfig->versionToLaunch], timerBak);
-                baseTime = time(NULL);
-            }
-            if (timer <= 0)
-                break;
-        }
-        updateUI();
+        g_exit = true;
+        cd.aborted = true;
     }
-    if (!noTimer)
+    if (cd.aborted) goto abort;
+    if (!cd.noTimer)
         removeAppStatus();
     appInfoEnableAutoUpdate();
     newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "Loading %s ...", versionString[bnConfig->versionToLaunch]);
     return (1);
 
 abort:
+    bnCancelPrefetch();
     appInfoEnableAutoUpdate();
     return (0);
 
@@ -8,16 +8,103 @@ extern ntrConfig_t  *ntrConfig;
 
 #define LOCAL_MAP_ADDR_SRC 0x24000000
 #define LOCAL_MAP_ADDR_DST 0x25000000
+#define LOCAL_MAP_ADDR_TEXT 0x28000000
+
+// Copies from this size go through the DMA engine. The callers move either
+// a few patch bytes (4 to 0x10) or a whole page (0x1000): the patch bytes
+// cost less to memcpy than a DMA setup and poll, the page reads leave the
+// CPU to the UI thread while they run.
+#define REMOTECOPY_DMA_MIN_SIZE     (0x1000)
+#define REMOTECOPY_DMA_POLL_NS      (100 * 1000)
+#define REMOTECOPY_DMA_TIMEOUT_NS   (2000 * 1000 * 1000LL)
+// The DMA couldn't start or was stopped: nothing writes the destination
+#define REMOTECOPY_DMA_ABORTED      (2)
+
+typedef u32 (*copyFunc_t)(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size);
+
+// Set once a DMA went through, see copyRemoteMemoryDma
+static bool dmaFinishStateKnown = false;
+
+// Write back the data written at addr, through any mapping of it, and drop
+// the stale instructions. A ranged I-cache invalidate only reaches the
+// current core while the patched processes run on the others, so the whole
+// I-cache goes, as the copy always did.
+void    syncWrittenRange(void *addr, u32 size)
+{
+    svcFlushDataCacheRange(addr, size);
+    svcInvalidateEntireInstructionCache();
+}
 
 u32     protectRemoteMemory(Handle hProcess, u32 addr, u32 size)
 {
     return (svcControlProcessMemory(hProcess, addr, addr, size, 6, 7));
 }
 
-u32     copyRemoteMemory(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size)
+// Poll until the kernel reports the transfer over
+static bool waitDma(Handle hDma, u32 *state)
+{
+    s64     waited;
+
+    for (waited = 0; waited < REMOTECOPY_DMA_TIMEOUT_NS; waited += REMOTECOPY_DMA_POLL_NS)
+    {
+        if (R_FAILED(svc_getDmaState(state, hDma)))
+            return (false);
+        if (*state > DMASTATE_RUNNING)
+            return (true);
+        svcSleepThread(REMOTECOPY_DMA_POLL_NS);
+    }
+    return (false);
+}
+
+// Copy backend for large transfers. The calling thread sleeps while the
+// DMA runs, so the UI loop keeps the CPU. The state the kernel reports at
+// the end is the one NTR waits for in its own transfers.
+static u32  copyRemoteMemoryDma(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size)
+{
+    DmaConfig   config;
+    Handle      hDma = 0;
+    u32         state = DMASTATE_STARTING;
+    Result      res;
+
+    memset(&config, 0, sizeof(config));
+    config.channelId = -1;
+    config.flags = DMACFG_WAIT_AVAILABLE;
+
+    // The DMA doesn't see the caches
+    svcFlushProcessDataCache(hSrc, ptrSrc, size);
+    svcFlushProcessDataCache(hDst, ptrDst, size);
+    res = svc_startInterProcessDma(&hDma, hDst, (void *)ptrDst, hSrc, (const void *)ptrSrc, size, (u32 *)&config);
+    if (R_FAILED(res))
+        return (REMOTECOPY_DMA_ABORTED);
+    if (!waitDma(hDma, &state))
+    {
+        // Never hand the destination to another copy while the channel may
+        // still write to it
+        if (R_FAILED(svcStopDma(hDma)) || R_FAILED(svc_getDmaState(&state, hDma)))
+        {
+            svcCloseHandle(hDma);
+            return (RESULT_ERROR);
+        }
+        if (state <= DMASTATE_RUNNING)
+        {
+            svcCloseHandle(hDma);
+            return (REMOTECOPY_DMA_ABORTED);
+        }
+    }
+    svcCloseHandle(hDma);
+
+    svcInvalidateProcessDataCache(hDst, ptrDst, size);
+    // No local mapping of the destination, see syncWrittenRange
+    svcInvalidateEntireInstructionCache();
+    ntrConfig->InterProcessDmaFinishState = state;
+    dmaFinishStateKnown = true;
+    return (0);
+}
+
+// Copy backend for small transfers: map both sides and memcpy
+static u32  copyRemoteMemoryMapped(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size)
 {
     bool isPlgLoader = isPluginLoaderLuma();
-    ntrConfig->InterProcessDmaFinishState = DMASTATE_STARTING;
     Result res = 0;
     Handle tmpHandle;
     u32 pageSrc = ptrSrc & ~0xFFF, pageDst = ptrDst & ~0xFFF;
@@ -38,7 +125,6 @@ u32     copyRemoteMemory(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 s
         svcUnmapProcessMemoryEx(tmpHandle, LOCAL_MAP_ADDR_SRC, pageSize);
         return RESULT_ERROR;
     }
-    ntrConfig->InterProcessDmaFinishState = DMASTATE_RUNNING;
 
     u32 currID = 0, remoteID = 0;
     svcGetProcessId(&currID, hDst);
@@ -46,22 +132,47 @@ u32     copyRemoteMemory(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 s
 
     if (isPlgLoader && currID != remoteID) svcControlProcess(hDst, PROCESSOP_SCHEDULE_THREADS, 1, 0); // More stable in 3GX Loader luma builds
     memcpy((u8*)(LOCAL_MAP_ADDR_DST + offsetDst), (u8*)(LOCAL_MAP_ADDR_SRC + offsetSrc), size);
+    // Only the copied range, while it's still mapped
+    syncWrittenRange((void *)(LOCAL_MAP_ADDR_DST + offsetDst), size);
 
     tmpHandle = isPlgLoader ? CUR_PROCESS_HANDLE : hDst;
     svcUnmapProcessMemoryEx(tmpHandle, LOCAL_MAP_ADDR_DST, pageSize);
 
     svcInvalidateProcessDataCache(hDst, (u32)ptrDst, size);
-    svcInvalidateEntireInstructionCache();
     if (isPlgLoader && currID != remoteID) svcControlProcess(hDst, PROCESSOP_SCHEDULE_THREADS, 0, 0);
 
     tmpHandle = isPlgLoader ? CUR_PROCESS_HANDLE : hSrc;
     svcUnmapProcessMemoryEx(tmpHandle, LOCAL_MAP_ADDR_SRC, pageSize);
 
-    svcSleepThread(10 * 1000 * 1000);
-    ntrConfig->InterProcessDmaFinishState = DMASTATE_DONE;
+    // What NTR used to be told when no DMA could be run
+    if (!dmaFinishStateKnown)
+        ntrConfig->InterProcessDmaFinishState = DMASTATE_DONE;
     return 0;
 }
 
+static const copyFunc_t copyBackends[COPY_BACKEND_COUNT] =
+{
+    [COPY_BACKEND_MAPPED] = copyRemoteMemoryMapped,
+    [COPY_BACKEND_DMA] = copyRemoteMemoryDma,
+};
+
+u32     copyRemoteMemoryWith(copyBackend_t backend, Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size)
+{
+    u32     ret;
+
+    if (backend == COPY_BACKEND_AUTO)
+        backend = size >= REMOTECOPY_DMA_MIN_SIZE ? COPY_BACKEND_DMA : COPY_BACKEND_MAPPED;
+    ret = copyBackends[backend](hDst, ptrDst, hSrc, ptrSrc, size);
+    if (ret == REMOTECOPY_DMA_ABORTED)
+        ret = copyRemoteMemoryMapped(hDst, ptrDst, hSrc, ptrSrc, size);
+    return (ret);
+}
+
+u32     copyRemoteMemory(Handle hDst, u32 ptrDst, Handle hSrc, u32 ptrSrc, u32 size)
+{
+    return (copyRemoteMemoryWith(COPY_BACKEND_AUTO, hDst, ptrDst, hSrc, ptrSrc, size));
+}
+
 u32     patchRemoteProcess(u32 pid, u32 addr, u8 *buf, u32 len)
 {
     if (!addr || !buf) return 0;
@@ -110,56 +221,6 @@ u32     rtCheckRemoteMemoryRegionSafeForWrite(Handle hProcess, u32 addr, u32 siz
     return (0);
 }
 
-#define ALPHABET_LEN 256
-
-// Quick Search algorithm, adapted from
-// http://igm.univ-mlv.fr/~lecroq/string/node19.html#SECTION00190
-u32     memfind(u8 *startPos, u32 size, const void *pattern, u32 patternSize)
-{
-    u32     i;
-    u32     j;
-    u32     table[ALPHABET_LEN];
-
-    const u8 *patternc = (const u8 *)pattern;
-
-    // Preprocessing
-    for (i = 0; i < ALPHABET_LEN; ++i)
-        table[i] = patternSize + 1;
-    for (i = 0; i < patternSize; ++i)
-        table[patternc[i]] = patternSize - i;
-
-    // Searching
-    j = 0;
-    while (j <= size - patternSize)
-    {
-        if (memcmp(patternc, startPos + j, patternSize) == 0)
-            return (j);
-        j += table[startPos[j + patternSize]];
-    }
-    return (0);
-}
-
-u32     findNearestSTMFD(u32 base, u32 pos)
-{
-    if (pos < base)
-    {
-        return 0;
-    }
-    pos = pos - pos % 4;
-    u32 term = pos - 0x1000;
-    if (term < base)
-    {
-        term = base;
-    }
-    while (pos >= term) {
-        if (*(u16*)(pos + 2) == 0xe92d){
-            return pos;
-        }
-        pos -= 4;
-    }
-    return 0;
-}
-
 u32     searchBytes(u32 startAddr, u32 endAddr, u8* pat, int patlen, int step)
 {
     u32 pat0 = ((u32*)pat)[0];
@@ -182,3 +243,96 @@ u32     searchBytes(u32 startAddr, u32 endAddr, u8* pat, int patlen, int step)
     return 0;
 }
 
+/*
+** Map the .text of pid, run the signature scanner over it and keep it mapped
+** so the hits can be resolved. closeProcessText must be called on success.
+** On failure, text->size tells whether the process could be queried.
+*/
+Result  scanProcessText(u32 pid, signature_t *sigs, u32 count, processText_t *text)
+{
+    s64     info;
+    Result  res;
+
+    memset(text, 0, sizeof(*text));
+    res = svcOpenProcess(&text->handle, pid);
+    if (R_FAILED(res))
+        return (res);
+    res = svcGetProcessInfo(&info, text->handle, 0x10005); // .text start
+    if (R_FAILED(res)) goto error;
+    text->start = (u32)info;
+    res = svcGetProcessInfo(&info, text->handle, 0x10002); // .text size
+    if (R_FAILED(res)) goto error;
+    text->size = (u32)info;
+
+    if (isPluginLoaderLuma()) res = svcMapProcessMemoryExPluginLoader(CUR_PROCESS_HANDLE, LOCAL_MAP_ADDR_TEXT, text->handle, text->start, text->size);
+    else res = svcMapProcessMemoryEx(text->handle, LOCAL_MAP_ADDR_TEXT, text->start, text->size);
+    if (R_FAILED(res)) goto error;
+    text->text = (const u8 *)LOCAL_MAP_ADDR_TEXT;
+
+    scanSignaturesIndexed(text->text, text->size, sigs, count, false, &text->index);
+    return (0);
+error:
+    svcCloseHandle(text->handle);
+    text->handle = 0;
+    return (res);
+}
+
+// Address of the first match in the process, 0 if not found
+u32     processTextAddr(const processText_t *text, const signature_t *sig)
+{
+    return (sig->hits ? text->start + sig->offset : 0);
+}
+
+// Address of the function containing the first match, 0 if not found
+u32     processTextFunction(const processText_t *text, const signature_t *sig, u32 window, u32 match)
+{
+    u32     prologue;
+
+    if (!sig->hits || !prologueLookup(&text->index, text->text, sig->offset, window, match, &prologue))
+        return (0);
+    return (text->start + prologue);
+}
+
+void    closeProcessText(processText_t *text)
+{
+    prologueIndexFree(&text->index);
+    // Same handle as the mapping, like copyRemoteMemory
+    if (text->text)
+        svcUnmapProcessMemoryEx(isPluginLoaderLuma() ? CUR_PROCESS_HANDLE : text->handle, LOCAL_MAP_ADDR_TEXT, text->size);
+    if (text->handle)
+        svcCloseHandle(text->handle);
+    memset(text, 0, sizeof(*text));
+}
+
+bool    linearArenaInit(linearArena_t *arena, u32 size)
+{
+    arena->used = 0;
+    arena->size = size;
+    arena->base = (u8 *)linearMemAlign(size, 0x1000);
+    if (!arena->base)
+        return (false);
+    // Reported by the users of the memory that needs it
+    arena->protectFailed = rtCheckRemoteMemoryRegionSafeForWrite(getCurrentProcessHandle(), (u32)arena->base, size) != 0;
+    return (true);
+}
+
+// align must be a power of 2, returns NULL when the arena is full
+void    *linearArenaAlloc(linearArena_t *arena, u32 size, u32 align)
+{
+    u32     offset;
+
+    if (!arena->base)
+        return (NULL);
+    offset = (arena->used + align - 1) & ~(align - 1);
+    if (offset > arena->size || size > arena->size - offset)
+        return (NULL);
+    arena->used = offset + size;
+    return (arena->base + offset);
+}
+
+void    linearArenaFree(linearArena_t *arena)
+{
+    if (arena->base)
+        linearFree(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,385 @@
+#include "ntrPatch.h"
+#include "scanner.h"
+#include "fileIO.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define RELOC_COUNT     NTRPATCH_RELOC_COUNT
+#define BASE            0x100100
+
+// Bump PATCH_STAMP_REVISION whenever patchBinary or fixDMAStateBug change
+// their output or patchStamp_t changes, so that binaries patched by an older
+// build get regenerated.
+#define PATCH_STAMP_MAGIC       0x504D5453 // "STMP"
+#define PATCH_STAMP_REVISION    3
+
+enum
+{
+    BINARY = 0,
+    PLUGIN,
+    DEBUG,
+    KERNEL,
+    FS,
+    PM,
+    SM,
+    HOMEMENU,
+    ARM
+};
+
+const char          *ntrPatchOriginalPath[RELOC_COUNT] =
+{
+    "/ntr.bin",
+    "/plugin/%s",
+    "/debug.flag",
+    "/axiwram.dmp",
+    "/pid0.dmp",
+    "/pid2.dmp",
+    "/pid3.dmp",
+    "/pidf.dmp",
+    "/arm11.bin"
+};
+
+static const char   *fixedName[RELOC_COUNT] =
+{
+    "",
+    "%s",
+    "",
+    "Kernel.dmp",
+    "FS.dmp",
+    "PM.dmp",
+    "SM.dmp",
+    "HomeMenu.dmp",
+    "arm11.dmp"
+};
+
+static const char   *ntrVersionStrings[] =
+{
+    // "ntr_3_2.bin",
+    // "ntr_3_3.bin",
+    "",
+    "",
+
+    // "ntr.o3ds.bin",
+    "ntr.bin",
+    "ntr.hr.boot.bin",
+    "ntr.hr.menu.bin",
+    "ntr.hr.pm.bin",
+    "ntr.hr.nwm.bin",
+    "ntr.hr.game.bin",
+};
+
+// const char **outNtrVersionStrings = ntrVersionStrings;
+const char *outNtrVersionStrings[] =
+{
+    // "ntr_3_2.bin",
+    // "ntr_3_3.bin",
+    "",
+    "",
+
+    "ntr.bin",
+    "ntr.hr.boot.bin",
+    "ntr.hr.menu.bin",
+    "ntr.hr.pm.bin",
+    "ntr.hr.nwm.bin",
+    "ntr.hr.game.bin",
+};
+
+// There was a bug in libctu where DMAState was read as a u32 instead of a u8.
+// In order to fix the NTR bins, we have to patch those bugs by changing a LDR to LDRB
+static const u32    ldrDMAStatePat1[] = { 0xE59D3014, 0xE3520000 }; // NTR 3.2, 3.3, O3DS 3.6
+static const u32    ldrDMAStatePat2[] = { 0xE59D2014, 0xE593305C }; // NTR N3DS 3.6
+
+enum
+{
+    SIG_DMA_PAT1 = 0,
+    SIG_DMA_PAT2,
+    SIG_XREF
+};
+
+static void fixDMAStateBug(u8 *mem, const signature_t *pat1, const signature_t *pat2)
+{
+    u32     offset;
+
+    if (!pat1->hits && !pat2->hits)
+        return;
+    if (pat1->hits && (!pat2->hits || pat1->offset < pat2->offset))
+        offset = pat1->offset;
+    else
+        offset = pat2->offset;
+    mem[offset + 2] = 0xDD; // Convert LDR to LDRB
+}
+
+static void patchBinary(ntrPatch_t *pj, volatile u32 *progress)
+{
+    int         i;
+    int         expand;
+    int         size;
+    char        *str;
+    u8          *mem;
+    u32         offset;
+    u32         patchOffset;
+    u32         *patchRel;
+    u32         strlength;
+    u32         sigCount;
+    bool        fixDMA;
+    u32         xrefs[RELOC_COUNT];
+    int         sigIndex[RELOC_COUNT];
+    signature_t sigs[SIG_XREF + RELOC_COUNT];
+
+    mem = pj->mem;
+    size = pj->size;
+    fixDMA = pj->version <= SELECT_V36;
+    memset(sigs, 0, sizeof(sigs));
+
+    // Locate and clear the original strings, queueing a pointer lookup for each
+    sigCount = SIG_XREF;
+    for (i = 0; i < RELOC_COUNT; i++)
+    {
+        sigIndex[i] = -1;
+
+        // Skip auto enable debugger on O3DS
+        if (i == 2 && !pj->isNew3DS)
+            continue;
+
+        str = (char *)ntrPatchOriginalPath[i];
+        strlength = strlen(str);
+        offset = memfind(mem, size, str, strlength);
+        if (offset == 0)
+        {
+            pj->notFound |= BIT(i);
+            continue;
+        }
+
+        // Clear string data
+        memset(&mem[offset], 0, strlength);
+
+        // Rebase pointer relative to NTRs base.
+        xrefs[i] = offset + BASE;
+        sigs[sigCount].pattern = &xrefs[i];
+        sigs[sigCount].count = 1;
+        sigIndex[i] = sigCount++;
+    }
+    *progress = 40;
+
+    // One pass over the whole image finds the DMAState LDR and every xref.
+    // The LDR isn't windowed per version: the xrefs need the full scan
+    // anyway, so a window would only add offsets to keep in sync with NTR.
+    if (fixDMA)
+    {
+        sigs[SIG_DMA_PAT1].pattern = ldrDMAStatePat1;
+        sigs[SIG_DMA_PAT1].count = 2;
+        sigs[SIG_DMA_PAT2].pattern = ldrDMAStatePat2;
+        sigs[SIG_DMA_PAT2].count = 2;
+    }
+    scanSignatures(mem, size, sigs, sigCount, false);
+    if (fixDMA)
+        fixDMAStateBug(mem, &sigs[SIG_DMA_PAT1], &sigs[SIG_DMA_PAT2]);
+    *progress = 80;
+
+    expand = 0;
+    for (i = 0; i < RELOC_COUNT; i++)
+    {
+        if (sigIndex[i] < 0)
+            continue;
+
+        // Find xref
+        if (!sigs[sigIndex[i]].hits)
+        {
+            pj->missingXref = i;
+            break;
+        }
+
+        // New offset is end + patch count * buffer
+        patchOffset = size + (0x100 * expand);
+        strcpy((void *)&mem[patchOffset], pj->fixedPath[i]);
+
+        expand += 1;
+
+        patchRel = (u32 *)(&mem[sigs[sigIndex[i]].offset]);
+        // Rebase new pointer
+        *patchRel = patchOffset + BASE;
+    }
+}
+
+// Hash everything that ends up in the patched binary besides the romfs source
+static u32  getParamsCrc(ntrPatch_t *pj)
+{
+    u32     crc;
+    u32     isNew3DS;
+    int     i;
+
+    isNew3DS = pj->isNew3DS;
+    crc = crc32(0L, Z_NULL, 0);
+    for (i = 0; i < RELOC_COUNT; i++)
+        crc = crc32(crc, (const Bytef *)pj->fixedPath[i], strlen(pj->fixedPath[i]) + 1);
+    crc = crc32(crc, (const Bytef *)&pj->version, sizeof(pj->version));
+    crc = crc32(crc, (const Bytef *)&isNew3DS, sizeof(isNew3DS));
+    return (crc);
+}
+
+bool    ntrPatchReadStamp(const char *stampPath, patchStamp_t *stamp)
+{
+    FILE    *file;
+    bool    ok;
+
+    fileRecover(stampPath);
+    file = fopen(stampPath, "rb");
+    if (!file)
+        return (false);
+    ok = fread(stamp, sizeof(*stamp), 1, file) == 1;
+    fclose(file);
+    return (ok && stamp->magic == PATCH_STAMP_MAGIC && stamp->revision == PATCH_STAMP_REVISION);
+}
+
+// The output exists, has the size the stamp recorded and was patched for
+// these paths. The stamp is written last, so a torn write fails this.
+static bool isOutputComplete(ntrPatch_t *pj, patchStamp_t *stamp)
+{
+    struct stat     st;
+
+    // A leftover temp file means the last save didn't finish
+    if (fileRecover(pj->outPath)) goto error;
+    if (!ntrPatchReadStamp(pj->stampPath, stamp)) goto error;
+    if (stamp->paramsCrc != getParamsCrc(pj)) goto error;
+    if (stat(pj->outPath, &st) != 0 || st.st_size != stamp->outputSize) goto error;
+    return (true);
+error:
+    return (false);
+}
+
+static bool isOutputCurrent(ntrPatch_t *pj, const patchStamp_t *expected)
+{
+    patchStamp_t    stamp;
+
+    return (isOutputComplete(pj, &stamp) && stamp.sourceCrc == expected->sourceCrc);
+}
+
+bool    ntrPatchCheckOutput(ntrPatch_t *pj)
+{
+    patchStamp_t    stamp;
+
+    return (isOutputComplete(pj, &stamp));
+}
+
+static bool joinPath(char *dst, const char *s1, const char *s2, const char *s3)
+{
+    int     len;
+
+    len = snprintf(dst, NTRPATCH_PATH_SIZE, "%s%s%s", s1, s2, s3);
+    return (len >= 0 && len < NTRPATCH_PATH_SIZE);
+}
+
+// Returns false if one of the paths doesn't fit in NTRPATCH_PATH_SIZE
+bool    ntrPatchInit(ntrPatch_t *pj, version_t version, const char *inDir,
+                     const char *outRoot, const char *binPath, const char *plgPath, bool isNew3DS)
+{
+    bool    ok;
+
+    memset(pj, 0, sizeof(*pj));
+    pj->version = version;
+    pj->isNew3DS = isNew3DS;
+    pj->missingXref = -1;
+
+    if (!strncmp("sdmc:", binPath, 5)) binPath += 5;
+    if (!strncmp("sdmc:", plgPath, 5)) plgPath += 5;
+
+    ok = joinPath(pj->inPath, inDir, ntrVersionStrings[version/* + (version >= SELECT_V36 && isNew3DS)*/], "");
+    ok &= joinPath(pj->outPath, outRoot, binPath, outNtrVersionStrings[version]);
+    ok &= joinPath(pj->stampPath, pj->outPath, ".stamp", "");
+
+    // if (version != V32)
+    // {
+        ok &= joinPath(pj->fixedPath[PLUGIN], plgPath, fixedName[PLUGIN], "");
+        ok &= joinPath(pj->fixedPath[BINARY], binPath, outNtrVersionStrings[version], "");
+        ok &= joinPath(pj->fixedPath[DEBUG], binPath, outNtrVersionStrings[version], "");
+        ok &= joinPath(pj->fixedPath[KERNEL], binPath, fixedName[KERNEL], "");
+        ok &= joinPath(pj->fixedPath[FS], binPath, fixedName[FS], "");
+        ok &= joinPath(pj->fixedPath[PM], binPath, fixedName[PM], "");
+        ok &= joinPath(pj->fixedPath[SM], binPath, fixedName[SM], "");
+        ok &= joinPath(pj->fixedPath[HOMEMENU], binPath, fixedName[HOMEMENU], "");
+        ok &= joinPath(pj->fixedPath[ARM], binPath, fixedName[ARM], "");
+    // }
+    // // 3.2
+    // else
+    // {
+    //     strcpy(outPath, originalPath[BINARY]);
+    // }
+    return (ok);
+}
+
+// Read the romfs binary and check whether the output is already current
+ntrPatchError_t ntrPatchLoad(ntrPatch_t *pj)
+{
+    fileIO_t    ntr;
+    u64         size;
+    u32         read;
+    bool        ok;
+
+    if (!fileOpen(&ntr, pj->inPath, FILEIO_READ))
+        return (NTRPATCH_OPEN_INPUT);
+    if (!fileGetSize(&ntr, &size))
+    {
+        fileClose(&ntr);
+        return (NTRPATCH_OPEN_INPUT);
+    }
+    pj->size = size;
+    // newSize = (version == V32) ? size : size + (RELOC_COUNT * 0x100);
+    pj->newSize = pj->size + (RELOC_COUNT * 0x100);
+    pj->mem = (u8 *)calloc(1, pj->newSize);
+    if (!pj->mem)
+    {
+        fileClose(&ntr);
+        return (NTRPATCH_ALLOC);
+    }
+    // One transfer straight into the patch buffer, a short one would be
+    // patched and stamped as good
+    ok = fileRead(&ntr, pj->mem, pj->size, &read) && read == pj->size;
+    fileClose(&ntr);
+    if (!ok)
+    {
+        ntrPatchFree(pj);
+        return (NTRPATCH_READ_INPUT);
+    }
+
+    // Skip the version if the output was already generated from the same
+    // romfs binary with the same paths
+    pj->stamp.magic = PATCH_STAMP_MAGIC;
+    pj->stamp.revision = PATCH_STAMP_REVISION;
+    pj->stamp.sourceCrc = crc32(crc32(0L, Z_NULL, 0), pj->mem, pj->size);
+    pj->stamp.paramsCrc = getParamsCrc(pj);
+    pj->stamp.outputSize = pj->newSize;
+    if (isOutputCurrent(pj, &pj->stamp))
+    {
+        ntrPatchFree(pj);
+        pj->upToDate = true;
+    }
+    return (NTRPATCH_OK);
+}
+
+// CPU bound part, safe to run on a worker thread
+void    ntrPatchRun(ntrPatch_t *pj, volatile u32 *progress)
+{
+    // if (version != V32)
+        patchBinary(pj, progress);
+}
+
+ntrPatchError_t ntrPatchSave(ntrPatch_t *pj)
+{
+    pj->stamp.outputCrc = crc32(crc32(0L, Z_NULL, 0), pj->mem, pj->newSize);
+    // Drop the old stamp first so an interrupted update is never seen as
+    // current, the output itself is replaced atomically
+    remove(pj->stampPath);
+    if (!fileWriteAtomic(pj->outPath, pj->mem, pj->newSize))
+        return (NTRPATCH_WRITE_OUTPUT);
+    fileWriteAtomic(pj->stampPath, &pj->stamp, sizeof(pj->stamp));
+    return (NTRPATCH_OK);
+}
+
+void    ntrPatchFree(ntrPatch_t *pj)
+{
+    free(pj->mem);
+    pj->mem = NULL;
+}
@@ -0,0 +1,98 @@
+#ifndef NTRPATCH_H
+#define NTRPATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __3DS__
+#include <3ds/types.h>
+#else
+typedef uint8_t   u8;
+typedef uint32_t  u32;
+#endif
+
+#ifndef BIT
+#define BIT(n) (1U<<(n))
+#endif
+
+/*
+** Platform-neutral NTR binary patcher, shared by loadAndPatch() on the
+** console and by the host tools. Only depends on stdio and zlib.
+*/
+
+#define NTRPATCH_RELOC_COUNT    9
+#define NTRPATCH_PATH_SIZE      0x100
+
+typedef enum    version_e
+{
+    // V32 = 0,
+    // V33 = 1,
+    SELECT_V36 = 2,
+    SELECT_V36HR = 3,
+    SELECT_V36HR_MENU,
+    SELECT_V36HR_PM,
+    SELECT_V36HR_NWM,
+    SELECT_V36HR_GAME,
+    SELECT_V36HR_MAX
+}               version_t;
+
+typedef enum    ntrPatchError_e
+{
+    NTRPATCH_OK = 0,
+    NTRPATCH_OPEN_INPUT,
+    NTRPATCH_READ_INPUT,
+    NTRPATCH_ALLOC,
+    NTRPATCH_WRITE_OUTPUT
+}               ntrPatchError_t;
+
+typedef struct  patchStamp_s
+{
+    u32         magic;
+    u32         revision;
+    u32         sourceCrc;
+    u32         paramsCrc;
+    u32         outputSize;
+    u32         outputCrc;
+}               patchStamp_t;
+
+// Everything needed to patch one version, so the patch itself can run on a
+// worker thread while the caller reads and writes the other versions
+typedef struct  ntrPatch_s
+{
+    version_t       version;
+    u8              *mem;
+    int             size;
+    int             newSize;
+    char            fixedPath[NTRPATCH_RELOC_COUNT][NTRPATCH_PATH_SIZE];
+    char            inPath[NTRPATCH_PATH_SIZE];
+    char            outPath[NTRPATCH_PATH_SIZE];
+    char            stampPath[NTRPATCH_PATH_SIZE];
+    patchStamp_t    stamp;
+    u32             notFound;       // bitmask of the strings that weren't found
+    int             missingXref;    // index of the relocation without pointer or -1
+    bool            isNew3DS;
+    bool            upToDate;
+}               ntrPatch_t;
+
+extern const char   *ntrPatchOriginalPath[NTRPATCH_RELOC_COUNT];
+extern const char   *outNtrVersionStrings[];
+
+/*
+** binPath and plgPath are the paths NTR will see on the console (with or
+** without the "sdmc:" prefix). inDir is where the romfs binaries are read
+** from and outRoot is prepended to binPath to locate the output file.
+** Returns false if a path would be truncated.
+*/
+bool            ntrPatchInit(ntrPatch_t *patch, version_t version, const char *inDir,
+                             const char *outRoot, const char *binPath, const char *plgPath, bool isNew3DS);
+ntrPatchError_t ntrPatchLoad(ntrPatch_t *patch);
+void            ntrPatchRun(ntrPatch_t *patch, volatile u32 *progress);
+ntrPatchError_t ntrPatchSave(ntrPatch_t *patch);
+void            ntrPatchFree(ntrPatch_t *patch);
+
+// Cheap startup check of an output against its stamp: size and paths only,
+// the content is checked against stamp.outputCrc when it's read anyway
+bool            ntrPatchCheckOutput(ntrPatch_t *patch);
+bool            ntrPatchReadStamp(const char *stampPath, patchStamp_t *stamp);
+
+#endif
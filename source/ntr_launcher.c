@@ -1,6 +1,9 @@
 #include "main.h"
 #include "config.h"
 #include "csvc.h"
+#include "jobs.h"
+#include "fileIO.h"
+#include <zlib.h>
 
 extern ntrConfig_t      *ntrConfig;
 extern bootNtrConfig_t  *bnConfig;
@@ -10,7 +13,7 @@ extern char             *g_primary_error;
 extern char             *g_secondary_error;
 extern char             *g_third_error;
 
-int         isNTRAlreadyLaunched(void)
+Result      isNTRAlreadyLaunched(void)
 {
     Result  ret;
     Handle  processHandle;
@@ -46,55 +49,21 @@ bool        isPluginLoaderLuma()
 
 u32         findCustomPMsvcRunPattern(u32* outaddr)
 {
-    Handle prochand;
-    bool isPlgLoader = isPluginLoaderLuma();
-    u32 textStart = 0;
+    static const u32 svcRunPat[] = { 0xEF000012 }; // svc 0x12
+    signature_t sig = { .pattern = svcRunPat, .count = 1 };
+    processText_t text;
+    u32 res;
+
     *outaddr = 0;
-    u32 res = 0;
-    res = svcOpenProcess(&prochand, ntrConfig->PMPid); //pm processID
-    if (res)
-    {
-        return res;
-    }
-    s64 info;
-    res = svcGetProcessInfo(&info, prochand, 0x10005); //get start of .text
+    res = scanProcessText(ntrConfig->PMPid, &sig, 1, &text);
     if (res)
     {
         return res;
     }
-    u32* addr = (u32*)(u32)info;
-    textStart = info;
-    res = svcGetProcessInfo(&info, prochand, 0x10002); //get .text size
-    if (res)
-    {
-        return res;
-    }
-    if (isPlgLoader) res = svcMapProcessMemoryExPluginLoader(CURRENT_PROCESS_HANDLE, 0x28000000, prochand, (u32)addr, (u32)info);
-    else res = svcMapProcessMemoryEx(prochand, 0x28000000, (u32)addr, (u32)info); //map PM process memory into this process @ 0x08000000
-    if (res)
-    {
-        return res;
-    }
-    addr = (u32*)0x28000000;
-    u32* endAddr = (u32*)((u32)addr + (u32)info);
-    while (addr < endAddr)
-    {
-        if (*addr == 0xEF000012) // Find svc 0x12
-        {
-            u32* addr2 = addr;
-            while (*addr2 != 0xE92D0030 && (u32)addr - (u32)addr2 < 0x100) addr2--; // Find start of the svc function
-            if ((u32)addr - (u32)addr2 < 0x100)
-            {
-                *outaddr = ((u32)addr2 - 0x28000000) + textStart;
-            }
-            else res = -1;
-            break;
-        }
-        addr++;
-    }
-    if (addr >= endAddr) res = -1;
-    svcUnmapProcessMemoryEx(CURRENT_PROCESS_HANDLE, 0x28000000, (u32)info);
-    svcCloseHandle(prochand);
+    // Find start of the svc function
+    *outaddr = processTextFunction(&text, &sig, 0xFC, 0xE92D0030);
+    if (!*outaddr) res = -1;
+    closeProcessText(&text);
     return res;
 }
 
@@ -124,7 +93,8 @@ Result      bnPatchAccessCheck(void)
     svcBackdoor(backdoorHandler);
 
     // Do a dma copy to get the finish state value on current console
-    ret = copyRemoteMemory(CURRENT_PROCESS_HANDLE, (u32)tmpBuffer, CURRENT_PROCESS_HANDLE, (u32)tmpBuffer + 0x10, 0x10);
+    ret = copyRemoteMemoryWith(COPY_BACKEND_DMA, CURRENT_PROCESS_HANDLE, (u32)tmpBuffer,
+                               CURRENT_PROCESS_HANDLE, (u32)tmpBuffer + 0x10, 0x10);
     check_sec(ret, REMOTECOPY_FAILURE);
 
     ret = patchRemoteProcess(bnConfig->FSPid, bnConfig->FSPatchAddr, (u8 *)&fsPatchValue, 4);
@@ -141,68 +111,217 @@ error:
     return (RESULT_ERROR);
 }
 
-u32 loadNTRBin(version_t versionToLaunch)
+typedef struct  ntrImage_s
 {
-    u32                 size;
-    u32                 alignedSize;
-    u8                  *mem;
-    FILE                *ntr;
-    u32                 ret;
-    char                path[0x100];
+    version_t       version;
+    char            path[0x100];
+    u8              *mem;           // alignedSize * 2 bytes of linear memory
+    u32             size;
+    u32             alignedSize;
+    bool            openFailed;
+    bool            protectFailed;
+    bool            corrupted;      // doesn't match its stamp
+    bool            ownsMem;        // mem is outside of the arena
+}               ntrImage_t;
+
+// NTR binaries read from the SD by a job while the Home Menu is scanned
+static ntrImage_t       ntrImages[2];
+static int              ntrImageCount = 0;
+static job_t            ntrReadJob;
+
+// tmpBuffer and the NTR images, nothing is freed until the boot is over
+static linearArena_t    bootArena;
+// Version the arena and the images are set up for, the prefetch may have
+// picked it before the user changed bnConfig->versionToLaunch
+static version_t        bootVersion;
+
+// Dropping the stamp gets the binary patched again on the next start
+static void     setNTRBinCorrupted(ntrImage_t *img)
+{
+    char            stampPath[0x110];
 
+    img->corrupted = true;
+    snprintf(stampPath, sizeof(stampPath), "%s.stamp", img->path);
+    remove(stampPath);
+}
+
+// The bytes are read anyway, check them against the stamp written with them
+static void     checkNTRBin(ntrImage_t *img)
+{
+    patchStamp_t    stamp;
+    char            stampPath[0x110];
+
+    snprintf(stampPath, sizeof(stampPath), "%s.stamp", img->path);
+    if (!ntrPatchReadStamp(stampPath, &stamp))
+        return;
+    if (stamp.outputSize != img->size || stamp.outputCrc != crc32(crc32(0L, Z_NULL, 0), img->mem, img->size))
+        setNTRBinCorrupted(img);
+}
 
+// Job: SD read straight into the first half of each image, the FS service
+// writes into the linear memory without going through a stdio buffer
+static void     readNTRBins(void *arg, volatile u32 *progress)
+{
+    ntrImage_t  *img;
+    fileIO_t    ntr;
+    u32         read;
+    int         i;
+
+    for (i = 0; i < ntrImageCount; i++)
+    {
+        img = &ntrImages[i];
+        if (!img->mem)
+            continue;
+        if (!fileOpen(&ntr, img->path, FILEIO_READ))
+        {
+            img->openFailed = true;
+            continue;
+        }
+        memset(img->mem, 0, img->alignedSize * 2);
+        // Short of what stat reported, the binary must not be placed
+        if (!fileRead(&ntr, img->mem, img->size, &read) || read != img->size)
+            setNTRBinCorrupted(img);
+        else
+            checkNTRBin(img);
+        fileClose(&ntr);
+        *progress = (i + 1) * 100 / ntrImageCount;
+    }
+}
+
+static u32      ntrImageSize(u32 binSize)
+{
+    return (rtAlignToPageSize(binSize) * 2);
+}
+
+static void     initNTRImage(ntrImage_t *img, version_t version)
+{
     extern const char *outNtrVersionStrings[];
     // extern const char **outNtrVersionStrings;
+    struct stat st;
 
+    memset(img, 0, sizeof(*img));
+    img->version = version;
     // if (bnConfig->versionToLaunch == V32)
     //     strJoin(path, "/", "ntr.bin");
     // else
-        strJoin(path, bnConfig->config->binariesPath + 5, outNtrVersionStrings[versionToLaunch]);
+        strJoin(img->path, bnConfig->config->binariesPath + 5, outNtrVersionStrings[version]);
+    if (stat(img->path, &st))
+    {
+        img->openFailed = true;
+        return;
+    }
+    img->size = st.st_size;
+    img->alignedSize = rtAlignToPageSize(img->size);
+    img->mem = (u8 *)linearArenaAlloc(&bootArena, img->alignedSize * 2, 0x1000);
+    img->protectFailed = bootArena.protectFailed;
+    // Outdated estimate, the image will live outside of the arena
+    if (!img->mem)
+    {
+        img->mem = (u8 *)linearMemAlign(img->alignedSize * 2, 0x1000);
+        img->ownsMem = img->mem != NULL;
+        if (img->mem)
+            img->protectFailed = rtCheckRemoteMemoryRegionSafeForWrite(getCurrentProcessHandle(), (u32)img->mem, img->alignedSize * 2) != 0;
+    }
+}
+
+// Boot stage: reserve linear memory for the whole boot, sized from the romfs
+// binaries the SD ones are patched from
+static Result   initBootArena(void)
+{
+    extern const char *outNtrVersionStrings[];
+    char        path[0x100];
+    struct stat st;
+    u32         size;
+    version_t   versions[2];
+    int         count;
+    int         i;
+
+    count = 0;
+    versions[count++] = bootVersion;
+    if (bootVersion == SELECT_V36HR)
+        versions[count++] = SELECT_V36HR_MENU;
+    size = TMPBUFFER_SIZE;
+    for (i = 0; i < count; i++)
+    {
+        strJoin(path, "romfs:/", outNtrVersionStrings[versions[i]]);
+        if (!stat(path, &st))
+            size += ntrImageSize(st.st_size + NTRPATCH_RELOC_COUNT * 0x100);
+    }
+    if (!linearArenaInit(&bootArena, size))
+        return (RESULT_ERROR);
+    tmpBuffer = (u8 *)linearArenaAlloc(&bootArena, TMPBUFFER_SIZE, 0x1000);
+    return (0);
+}
+
+// Boot stage: queue the read of the binaries needed by bnLoadAndExecuteNTR
+static Result   startNTRRead(void)
+{
+    ntrImageCount = 0;
+    initNTRImage(&ntrImages[ntrImageCount++], bootVersion);
+    if (bootVersion == SELECT_V36HR)
+        initNTRImage(&ntrImages[ntrImageCount++], SELECT_V36HR_MENU);
+    jobsInit(1);
+    jobSubmit(&ntrReadJob, readNTRBins, NULL);
+    return (0);
+}
+
+// Join the read job, safe to call if it never started. On success the
+// images belong to NTR, discard frees the ones outside of the arena.
+static void     endNTRRead(bool discard)
+{
+    int     i;
+
+    if (!ntrImageCount)
+        return;
+    jobWait(&ntrReadJob);
+    jobsExit();
+    for (i = 0; discard && i < ntrImageCount; i++)
+    {
+        if (ntrImages[i].ownsMem)
+            linearFree(ntrImages[i].mem);
+    }
+    ntrImageCount = 0;
+}
+
+// Drop the SD read and the memory set up for bootVersion
+static void     discardNTRRead(void)
+{
+    endNTRRead(true);
+    linearArenaFree(&bootArena);
+    tmpBuffer = NULL;
+}
+
+static u32      placeNTRBin(ntrImage_t *img)
+{
+    u8                  *mem;
 
     // if (bnConfig->versionToLaunch == V32)
     //     strcpy(ntrConfig->path, path);
-    if (versionToLaunch == SELECT_V36)
+    if (img->version == SELECT_V36)
     {
-        strcpy(ntrConfig->path, path);
+        strcpy(ntrConfig->path, img->path);
     #if EXTENDEDMODE
         ntrConfig->memorymode = 3;
     #else
         ntrConfig->memorymode = 0;
     #endif
-    } else if (versionToLaunch == SELECT_V36HR) {
+    } else if (img->version == SELECT_V36HR) {
         char *binPath = bnConfig->config->binariesPath;
         if (!strncmp("sdmc:", binPath, 5)) binPath += 5;
         strcpy(ntrConfig->path, binPath);
     }
 
-    // Get size
-    ntr = fopen(path, "rb");
-    check_prim(!ntr, FILEOPEN_FAILURE);
-    fseek(ntr, 0, SEEK_END);
-    size = ftell(ntr);
-    fseek(ntr, 0, SEEK_SET);
-    alignedSize = rtAlignToPageSize(size);
-    ntrConfig->arm11BinSize = alignedSize;
-
-    // Allocate memory
-    mem = (u8 *)linearMemAlign(alignedSize * 2, 0x1000);
-    check_sec(!mem, LINEARMEMALIGN_FAILURE);
-    ntrConfig->arm11BinStart = ((u32)mem + alignedSize);
-    ret = rtCheckRemoteMemoryRegionSafeForWrite(getCurrentProcessHandle(), (u32)mem, alignedSize * 2);
-    check_prim(ret, PROTECTMEMORY_FAILURE);
-
-    // Read to memory
-    memset(mem, 0, alignedSize * 2);
-    u8 *temp = (u8 *)calloc(1, alignedSize);
-    fread(temp, size, 1, ntr);
-    fclose(ntr);
-    svcFlushProcessDataCache(getCurrentProcessHandle(), (u32)temp, alignedSize);
-
-    svcInvalidateProcessDataCache(getCurrentProcessHandle(), (u32)mem, alignedSize * 2);
-    memcpy(mem, temp, size);
-    memcpy(mem + alignedSize, temp, size);
-    svcFlushProcessDataCache(getCurrentProcessHandle(), (u32)mem, alignedSize *2);
-    free(temp);
+    check_prim(img->openFailed, FILEOPEN_FAILURE);
+    check_prim(img->corrupted, NTR_BINARY_CORRUPTED);
+    check_sec(!img->mem, LINEARMEMALIGN_FAILURE);
+    check_prim(img->protectFailed, PROTECTMEMORY_FAILURE);
+    mem = img->mem;
+    ntrConfig->arm11BinSize = img->alignedSize;
+    ntrConfig->arm11BinStart = ((u32)mem + img->alignedSize);
+
+    // The job read the binary in the first half, NTR wants a second copy
+    memcpy(mem + img->alignedSize, mem, img->size);
+    svcFlushProcessDataCache(getCurrentProcessHandle(), (u32)mem, img->alignedSize * 2);
     return ((u32)mem);
 error:
     return (RESULT_ERROR);
@@ -211,9 +330,15 @@ error:
 Result      bnLoadAndExecuteNTR(void)
 {
     u32     outAddr;
+    u32     menuBin;
     u32     *bootArgs;
 
-    outAddr = loadNTRBin(bnConfig->versionToLaunch);
+    // Join the SD read started before the Home Menu analysis
+    if (!ntrImageCount)
+        startNTRRead();
+    jobWait(&ntrReadJob);
+
+    outAddr = placeNTRBin(&ntrImages[0]);
     if (outAddr == RESULT_ERROR)
     {
             goto error;
@@ -223,7 +348,7 @@ Result      bnLoadAndExecuteNTR(void)
 
     if (bnConfig->versionToLaunch == SELECT_V36HR) {
         bootArgs[0] = (u32)ntrConfig;
-        u32 menuBin = loadNTRBin(SELECT_V36HR_MENU);
+        menuBin = placeNTRBin(&ntrImages[1]);
         if (menuBin == RESULT_ERROR) {
             goto error;
         }
@@ -232,60 +357,226 @@ Result      bnLoadAndExecuteNTR(void)
         bootArgs[1] = 0xb00d;
         bootArgs[2] = (u32)ntrConfig;
     }
+    endNTRRead(false);
 
+    // Catch up on the ranged maintenance done by the copies, on every core
+    doFlushCache();
     ((funcType)(outAddr))();
     return (0);
 error:
+    discardNTRRead();
     return (RESULT_ERROR);
 }
+
 void        showDbg(char *str)
 {
      newAppTop(DEFAULT_COLOR, TINY | SKINNY, str);
 }
 
-Result      bnBootNTR(void)
+#define BOOT_STACK_SIZE     0x4000
+
+// Stages the prefetch can take off the boot
+#define PREFETCH_FIRMWARE   BIT(0)
+#define PREFETCH_ARENA      BIT(1)
+#define PREFETCH_READ       BIT(2)
+#define PREFETCH_HOMEMENU   BIT(3)
+
+typedef struct  bootStage_s
 {
-    Result  ret;
-    u8      *linearAddress;
+    Result      (*func)(void);
+    char        **errorSlot;    // NULL: fail silently
+    char        *error;
+    u32         prefetch;
+}               bootStage_t;
 
-    linearAddress = NULL;
+typedef struct  bootPipeline_s
+{
+    const bootStage_t   *stages;
+    int                 count;
+    u32                 skip;       // PREFETCH_* already done
+    u32                 completed;  // PREFETCH_* done by this run
+    volatile bool       abort;
+    volatile bool       done;
+    Result              ret;
+}               bootPipeline_t;
+
+static Result   checkPluginLoader(void)
+{
+    return (isPluginLoaderLuma() ? 0 : -1);
+}
 
-    // Check 3GX Loader
-    check_prim(isPluginLoaderLuma() ? 0 : -1, LUMA_3GX_NOT_INSTALLED);
+// Boot thread: run the stages, stopping between two of them if B was pressed
+static void     bootThreadMain(void *arg)
+{
+    bootPipeline_t  *boot = (bootPipeline_t *)arg;
+    int             i;
 
-    // Set firm params
-    check_prim(bnInitParamsByFirmware(), UNKNOWN_FIRM);
+    boot->ret = 0;
+    for (i = 0; i < boot->count && !boot->abort; i++)
+    {
+        if (boot->stages[i].prefetch & boot->skip)
+            continue;
+        if (boot->stages[i].func() != 0)
+        {
+            if (boot->stages[i].errorSlot)
+                *boot->stages[i].errorSlot = boot->stages[i].error;
+            boot->ret = RESULT_ERROR;
+            break;
+        }
+        boot->completed |= boot->stages[i].prefetch;
+    }
+    if (boot->abort)
+        boot->ret = RESULT_ERROR;
+    __atomic_store_n(&boot->done, true, __ATOMIC_RELEASE);
+}
 
-    // Alloc temp buffer
-    linearAddress = (u8 *)linearMemAlign(TMPBUFFER_SIZE, 0x1000);
-    tmpBuffer = linearAddress;
-    check_prim(!tmpBuffer, LINEARMEMALIGN_FAILURE);
-    rtCheckRemoteMemoryRegionSafeForWrite(getCurrentProcessHandle(), (u32)tmpBuffer, TMPBUFFER_SIZE);
-    ret = isNTRAlreadyLaunched();
-    check_prim(ret, NTR_ALREADY_LAUNCHED);
-    // Patch services
-    ret = bnPatchAccessCheck();
-    check_prim(ret, ACCESSPATCH_FAILURE);
-    // Patch custom PM
-    ret = bnPatchCustomPM();
-    check_prim(ret, CUSTOM_PM_PATCH_FAIL);
+static bool     bootFrame(void *arg)
+{
+    bootPipeline_t  *boot = (bootPipeline_t *)arg;
 
-    // Init home menu params
-    check_sec(bnInitParamsByHomeMenu(), UNKNOWN_HOMEMENU);
+    if (!boot->abort && abort_and_exit())
+        boot->abort = true;
+    return (!__atomic_load_n(&boot->done, __ATOMIC_ACQUIRE));
+}
 
-    // Free temp buffer
-    linearFree(linearAddress);
+// Boot work done while the main menu waits for the user: only the stages
+// that leave the other processes alone, bnBootNTR redoes what failed
+static const bootStage_t    prefetchStages[] =
+{
+    // The scan needs Luma's svcs
+    { checkPluginLoader, NULL, NULL, 0 },
+    { bnInitParamsByFirmware, NULL, NULL, PREFETCH_FIRMWARE },
+    { initBootArena, NULL, NULL, PREFETCH_ARENA },
+    { startNTRRead, NULL, NULL, PREFETCH_READ },
+    { bnTryParamsByHomeMenu, NULL, NULL, PREFETCH_HOMEMENU },
+};
+
+static bootPipeline_t       prefetch;
+static Thread               prefetchThread = NULL;
+
+void        bnPrefetchBoot(void)
+{
+    s32     prio;
+
+    if (prefetchThread)
+        return;
+    memset(&prefetch, 0, sizeof(prefetch));
+    prefetch.stages = prefetchStages;
+    prefetch.count = sizeof(prefetchStages) / sizeof(prefetchStages[0]);
+    bootVersion = bnConfig->versionToLaunch;
+    // Below the UI, the menu has to stay responsive
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    prefetchThread = threadCreate(bootThreadMain, &prefetch, BOOT_STACK_SIZE, prio + 1, -2, false);
+}
+
+// The boot thread's messages go through the appInfo ring, which only the
+// main thread drains: keep draining it while waiting or a full ring blocks
+// both threads
+static void     joinBootThread(Thread thread)
+{
+    while (R_DESCRIPTION(threadJoin(thread, 10000000ULL)) == RD_TIMEOUT)
+        appInfoFlushQueue();
+    appInfoFlushQueue();
+    threadFree(thread);
+}
+
+// Join the prefetch, returns the PREFETCH_* stages the boot can skip
+static u32      takePrefetch(void)
+{
+    u32     done;
+
+    if (!prefetchThread)
+        return (0);
+    joinBootThread(prefetchThread);
+    prefetchThread = NULL;
+    done = prefetch.completed;
+    // The user picked another version, only the params still hold
+    if (bootVersion != bnConfig->versionToLaunch)
+    {
+        discardNTRRead();
+        done &= PREFETCH_FIRMWARE | PREFETCH_HOMEMENU;
+    }
+    return (done);
+}
+
+void        bnCancelPrefetch(void)
+{
+    if (!prefetchThread)
+        return;
+    prefetch.abort = true;
+    takePrefetch();
+    discardNTRRead();
+}
+
+Result      bnBootNTR(void)
+{
+    bootPipeline_t  boot;
+    Thread          thread;
+    s32             prio;
+    Result          ret;
+
+    const bootStage_t stages[] =
+    {
+        // Check 3GX Loader
+        { checkPluginLoader, &g_primary_error, LUMA_3GX_NOT_INSTALLED, 0 },
+        // Set firm params
+        { bnInitParamsByFirmware, &g_primary_error, UNKNOWN_FIRM, PREFETCH_FIRMWARE },
+        // Reserve the boot memory, temp buffer included
+        { initBootArena, &g_primary_error, LINEARMEMALIGN_FAILURE, PREFETCH_ARENA },
+        { isNTRAlreadyLaunched, &g_primary_error, NTR_ALREADY_LAUNCHED, 0 },
+        // Patch services
+        { bnPatchAccessCheck, &g_primary_error, ACCESSPATCH_FAILURE, 0 },
+        // Patch custom PM
+        { bnPatchCustomPM, &g_primary_error, CUSTOM_PM_PATCH_FAIL, 0 },
+        // Read the NTR binaries while the Home Menu is analysed
+        { startNTRRead, &g_primary_error, FILEOPEN_FAILURE, PREFETCH_READ },
+        // Init home menu params
+        { bnInitParamsByHomeMenu, &g_secondary_error, UNKNOWN_HOMEMENU, PREFETCH_HOMEMENU },
+    };
+
+    memset(&boot, 0, sizeof(boot));
+    boot.stages = stages;
+    boot.count = sizeof(stages) / sizeof(stages[0]);
+    // Keep what was prepared during the main menu countdown
+    boot.skip = takePrefetch();
+    bootVersion = bnConfig->versionToLaunch;
+
+    // Home Menu scan and kernel patching are CPU bound, NTR gets the
+    // clock back before it takes over
+    perfModeSet(PERFMODE_BOOST);
+
+    // The stages run on the main thread's core, at a lower priority, so the
+    // kernel patches keep the same cache behaviour and the UI keeps drawing
+    svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+    thread = threadCreate(bootThreadMain, &boot, BOOT_STACK_SIZE, prio + 1, -2, false);
+    if (thread)
+    {
+        runUILoop(60, bootFrame, &boot);
+        joinBootThread(thread);
+    }
+    else
+        bootThreadMain(&boot);
+    // Let the last messages of the boot thread reach the screen
+    updateUI();
+    perfModeRestore();
+
+    // The temp buffer stays in the arena, which now belongs to NTR
+    tmpBuffer = NULL;
+    if (boot.ret)
+    {
+        discardNTRRead();
+        goto error;
+    }
 
     // Show debug logs from NTR if X is hold
     hidScanInput();
     if (bnConfig->isDebug || (hidKeysDown() | hidKeysHeld()) & KEY_X)
         ntrConfig->ShowDbgFunc = (u32)showDbg;
-    // Load NTR
+    // Load NTR, from the main thread as it never returns
     ret = bnLoadAndExecuteNTR();
     check_third(ret, LOAD_FAILED);
     return (ret);
 error:
-    if (linearAddress) linearFree(linearAddress);
     return (RESULT_ERROR);
 }
 
@@ -1,5 +1,7 @@
 #include "main.h"
 #include "config.h"
+#include "jobs.h"
+#include "ntrPatch.h"
 
 extern ntrConfig_t      *ntrConfig;
 extern bootNtrConfig_t  *bnConfig;
@@ -7,234 +9,190 @@ extern char             *g_primary_error;
 extern char             *g_secondary_error;
 extern char             *g_third_error;
 
-#define RELOC_COUNT     9
-#define BASE            0x100100
-
-enum
-{
-    BINARY = 0,
-    PLUGIN,
-    DEBUG,
-    KERNEL,
-    FS,
-    PM,
-    SM,
-    HOMEMENU,
-    ARM
-};
-
-static const char  *originalPath[RELOC_COUNT] =
-{
-    "/ntr.bin",
-    "/plugin/%s",
-    "/debug.flag",
-    "/axiwram.dmp",
-    "/pid0.dmp",
-    "/pid2.dmp",
-    "/pid3.dmp",
-    "/pidf.dmp",
-    "/arm11.bin"
-};
-
-static const char *fixedName[RELOC_COUNT] =
-{
-    "",
-    "%s",
-    "",
-    "Kernel.dmp",
-    "FS.dmp",
-    "PM.dmp",
-    "SM.dmp",
-    "HomeMenu.dmp",
-    "arm11.dmp"
-};
-
-static char fixedPath[RELOC_COUNT][0x100] = { 0 };
-
-static const char *ntrVersionStrings[] =
+typedef struct  patchJob_s
 {
-    // "ntr_3_2.bin",
-    // "ntr_3_3.bin",
-    "",
-    "",
-
-    // "ntr.o3ds.bin",
-    "ntr.bin",
-    "ntr.hr.boot.bin",
-    "ntr.hr.menu.bin",
-    "ntr.hr.pm.bin",
-    "ntr.hr.nwm.bin",
-    "ntr.hr.game.bin",
-};
-
-// const char **outNtrVersionStrings = ntrVersionStrings;
-const char *outNtrVersionStrings[] =
+    ntrPatch_t  patch;
+    Result      result;
+    job_t       job;
+}               patchJob_t;
+
+// Main thread: build the paths, read the romfs binary and check the stamp
+static Result   loadPatchJob(patchJob_t *pj, version_t version)
 {
-    // "ntr_3_2.bin",
-    // "ntr_3_3.bin",
-    "",
-    "",
-
-    "ntr.bin",
-    "ntr.hr.boot.bin",
-    "ntr.hr.menu.bin",
-    "ntr.hr.pm.bin",
-    "ntr.hr.nwm.bin",
-    "ntr.hr.game.bin",
-};
-
-// There was a bug in libctu where DMAState was read as a u32 instead of a u8.
-// In order to fix the NTR bins, we have to patch those bugs by changing a LDR to LDRB
-static void fixDMAStateBug(u32* start, size_t size) {
-    const u8 ldrDMAStatePat1[] = {0x14, 0x30, 0x9D, 0xE5, 0x00, 0x00, 0x52, 0xE3}; // NTR 3.2, 3.3, O3DS 3.6
-    const u8 ldrDMAStatePat2[] = {0x14, 0x20, 0x9D, 0xE5, 0x5C, 0x30, 0x93, 0xE5}; // NTR N3DS 3.6
-    u32* end = start + size/4 - sizeof(ldrDMAStatePat1)/4;
-    while(start != end) {
-        if (memcmp(start, ldrDMAStatePat1, sizeof(ldrDMAStatePat1)) == 0 || memcmp(start, ldrDMAStatePat2, sizeof(ldrDMAStatePat2)) == 0) {
-            ((u8*)start)[2] = 0xDD; // Convert LDR to LDRB
-            break;
-        }
-        start++;
+    ntrPatch_t  *patch = &pj->patch;
+
+    if (!ntrPatchInit(patch, version, "romfs:/", "", bnConfig->config->binariesPath,
+                      bnConfig->config->pluginPath, bnConfig->isNew3DS))
+    {
+        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch path too long.");
+        goto error;
     }
+    if (!patch->isNew3DS) {
+        clearTop(1);
+        newAppTop(COLOR_SALMON, SKINNY, "Support New 3DS only (Old 3DS detected).");
+        goto error;
+    }
+    switch (ntrPatchLoad(patch))
+    {
+    case NTRPATCH_OK:
+        break;
+    case NTRPATCH_ALLOC:
+        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch malloc error.");
+        goto error;
+    case NTRPATCH_READ_INPUT:
+        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch fread inPath \"%s\" error.", patch->inPath);
+        goto error;
+    default:
+        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch fopen inPath \"%s\" error.", patch->inPath);
+        goto error;
+    }
+    return (0);
+error:
+    pj->result = RESULT_ERROR;
+    return (RESULT_ERROR);
 }
 
-static void patchBinary(u8 *mem, int size)
+// Worker thread: CPU bound part, must not touch the UI
+static void     runPatchJob(void *arg, volatile u32 *progress)
 {
-    int     i;
-    int     expand;
-    char    *str;
-    u32     offset;
-    u32     *patchMe;
-    u32     patchOffset;
-    u32     *patchRel;
-    u32     strlength;
-
-    expand = 0;
-    for (i = 0; i < RELOC_COUNT; i++)
-    {
-        // Skip auto enable debugger on O3DS
-        if (i == 2 && !bnConfig->isNew3DS)
-            continue;
+    patchJob_t  *pj = (patchJob_t *)arg;
 
-        str = (char *)originalPath[i];
-        strlength = strlen(str);
-        offset = memfind(mem, size, str, strlength);
-        if (offset == 0)
-        {
-            if (bnConfig->isDebug)
-            {
-                newAppTop(DEFAULT_COLOR, TINY, "Not found \"%s\".", str);
-                updateUI();
-            }
-            continue;
-        }
+    ntrPatchRun(&pj->patch, progress);
+}
 
-        // Clear string data
-        memset(&mem[offset], 0, strlength);
+// Main thread: report what the worker found and write the output
+static Result   savePatchJob(patchJob_t *pj)
+{
+    ntrPatch_t  *patch = &pj->patch;
+    int         i;
 
-        // Rebase pointer relative to NTRs base.
-        offset += BASE;
-        patchMe = (u32 *)memfind(mem, size, (u8 *)&offset, 4); // Find xref
-        if (patchMe == 0)
+    if (bnConfig->isDebug)
+    {
+        for (i = 0; i < NTRPATCH_RELOC_COUNT; i++)
+            if (patch->notFound & BIT(i))
+                newAppTop(DEFAULT_COLOR, TINY, "Not found \"%s\".", ntrPatchOriginalPath[i]);
+        if (patch->missingXref >= 0)
         {
-            if (bnConfig->isDebug)
-            {
-                newAppTop(DEFAULT_COLOR, TINY, "Pointer for \"%s\"", str);
-                newAppTop(DEFAULT_COLOR, TINY, "is missing!Aborting.\n");
-                updateUI();
-            }
-            break;
+            newAppTop(DEFAULT_COLOR, TINY, "Pointer for \"%s\"", ntrPatchOriginalPath[patch->missingXref]);
+            newAppTop(DEFAULT_COLOR, TINY, "is missing!Aborting.\n");
         }
+        updateUI();
+    }
 
-        // New offset is end + patch count * buffer
-        patchOffset = size + (0x100 * expand);
-        strcpy((void *)&mem[patchOffset], fixedPath[i]);
+    if (ntrPatchSave(patch) != NTRPATCH_OK) {
+        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch write outPath \"%s\" error.", patch->outPath);
+        pj->result = RESULT_ERROR;
+    }
+    ntrPatchFree(patch);
+    return (pj->result);
+}
 
-        expand += 1;
+static void     waitPatchJob(patchJob_t *pj, int index, int count)
+{
+    u32     shown = ~0;
+    u32     progress;
 
-        patchRel = (u32 *)(&mem[(u32)patchMe]);
-        // Rebase new pointer
-        *patchRel = patchOffset + BASE;
+    // Keep the UI alive while the worker is busy
+    while (!jobIsDone(&pj->job))
+    {
+        progress = pj->job.progress;
+        if (progress != shown)
+        {
+            if (shown != (u32)~0)
+                removeAppStatus();
+            newAppStatus(DEFAULT_COLOR, CENTER | TINY | SKINNY, "Patching %d/%d: %d%%", index + 1, count, progress);
+            shown = progress;
+        }
+        updateUI();
     }
+    jobWait(&pj->job);
+    if (shown != (u32)~0)
+        removeAppStatus();
 }
 
-Result  loadAndPatch(version_t version)
+// Patch several versions: reading the romfs binaries and writing the
+// outputs stay on the main thread, patching is handed to the job workers
+Result  loadAndPatchVersions(const version_t *versions, int count, Result *results, bool *upToDate)
 {
-    FILE    *ntr;
-    int     size;
-    int     newSize;
-    char    *binPath;
-    char    *plgPath;
-    char    inPath[0x100];
-    char    outPath[0x100];
-    u8      *mem;
-    bool    isNew3DS = bnConfig->isNew3DS;
-
-    if (!isNew3DS) {
-        clearTop(1);
-        newAppTop(COLOR_SALMON, SKINNY, "Support New 3DS only (Old 3DS detected).");
-        goto error;
-    }
+    patchJob_t  *jobs;
+    Result      ret;
+    int         i;
 
-    binPath = bnConfig->config->binariesPath;
-    plgPath = bnConfig->config->pluginPath;
-
-    strJoin(inPath, "romfs:/", ntrVersionStrings[version/* + (version >= SELECT_V36 && isNew3DS)*/]);
-
-    if (!strncmp("sdmc:", binPath, 5)) binPath += 5;
-    if (!strncmp("sdmc:", plgPath, 5)) plgPath += 5;
-
-    // if (version != V32)
-    // {
-        strJoin(fixedPath[PLUGIN], plgPath, fixedName[PLUGIN]);
-        strJoin(outPath, binPath, outNtrVersionStrings[version]);
-        strJoin(fixedPath[BINARY], binPath, outNtrVersionStrings[version]);
-        strJoin(fixedPath[DEBUG], binPath, outNtrVersionStrings[version]);
-        strJoin(fixedPath[KERNEL], binPath, fixedName[KERNEL]);
-        strJoin(fixedPath[FS], binPath, fixedName[FS]);
-        strJoin(fixedPath[PM], binPath, fixedName[PM]);
-        strJoin(fixedPath[SM], binPath, fixedName[SM]);
-        strJoin(fixedPath[HOMEMENU], binPath, fixedName[HOMEMENU]);
-        strJoin(fixedPath[ARM], binPath, fixedName[ARM]);
-    // }
-    // // 3.2
-    // else
-    // {
-    //     strcpy(outPath, originalPath[BINARY]);
-    // }
-    ntr = fopen(inPath, "rb");
-    if (!ntr) {
-        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch fopen inPath \"%s\" error.", inPath);
-        goto error;
-    }
-    fseek(ntr, 0, SEEK_END);
-    size = ftell(ntr);
-    rewind(ntr);
-    // newSize = (version == V32) ? size : size + (RELOC_COUNT * 0x100);
-    newSize = size + (RELOC_COUNT * 0x100);
-    mem = (u8 *)malloc(newSize);
-    if (!mem) {
+    jobs = (patchJob_t *)calloc(count, sizeof(patchJob_t));
+    if (!jobs) {
         newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch malloc error.");
-        goto error;
+        return (RESULT_ERROR);
     }
-    memset(mem, 0, newSize);
-    fread(mem, size, 1, ntr);
-    fclose(ntr);
-    svcFlushProcessDataCache(CURRENT_PROCESS_HANDLE, (u32)mem, newSize);
-    if (version <= SELECT_V36)
-        fixDMAStateBug((u32*)mem, size);
-    // if (version != V32)
-        patchBinary(mem, size);
-    ntr = fopen(outPath, "wb");
-    if (!ntr) {
-        newAppTop(COLOR_SALMON, SKINNY, "loadAndPatch fopen outPath \"%s\" error.", outPath);
-        goto error;
+    jobsInit(1);
+    for (i = 0; i < count; i++)
+    {
+        if (loadPatchJob(&jobs[i], versions[i]) || jobs[i].patch.upToDate)
+            continue;
+        jobSubmit(&jobs[i].job, runPatchJob, &jobs[i]);
+        updateUI();
     }
-    fwrite(mem, newSize, 1, ntr);
-    fclose(ntr);
-    free(mem);
+    ret = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (jobs[i].patch.mem)
+        {
+            waitPatchJob(&jobs[i], i, count);
+            savePatchJob(&jobs[i]);
+        }
+        if (results)
+            results[i] = jobs[i].result;
+        if (upToDate)
+            upToDate[i] = jobs[i].patch.upToDate;
+        ret |= jobs[i].result;
+    }
+    jobsExit();
+    free(jobs);
+    return (ret);
+}
 
-    return(0);
-error:
-    return(RESULT_ERROR);
+Result  loadAndPatch(version_t version, bool *upToDate)
+{
+    return (loadAndPatchVersions(&version, 1, NULL, upToDate));
+}
+
+// Startup: patch again the binaries a crash left incomplete, instead of
+// going through the whole first launch. Only the stamps are checked unless
+// one of them fails or a save was interrupted.
+Result  repairBinaries(void)
+{
+    version_t   broken[SELECT_V36HR_MAX - SELECT_V36];
+    ntrPatch_t  *patch;
+    version_t   version;
+    perfMode_t  prevMode;
+    Result      ret;
+    int         count;
+
+    patch = (ntrPatch_t *)malloc(sizeof(ntrPatch_t));
+    if (!patch)
+        return (RESULT_ERROR);
+    count = 0;
+    for (version = SELECT_V36; version < SELECT_V36HR_MAX; version++)
+    {
+        if (!ntrPatchInit(patch, version, "romfs:/", "", bnConfig->config->binariesPath,
+                          bnConfig->config->pluginPath, bnConfig->isNew3DS)
+            || !ntrPatchCheckOutput(patch))
+            broken[count++] = version;
+    }
+    free(patch);
+    if (!count)
+        return (0);
+
+    newAppTop(COLOR_BLANK, SKINNY, "Repairing the NTR binaries...");
+    updateUI();
+    prevMode = perfModeSet(PERFMODE_BOOST);
+    ret = loadAndPatchVersions(broken, count, NULL, NULL);
+    perfModeSet(prevMode);
+    if (!bnConfig->isDebug)
+        removeAppTop();
+    if (ret)
+        newAppTop(COLOR_SALMON, SKINNY, "Repairing the NTR binaries... Error.");
+    else
+        newAppTop(COLOR_LIMEGREEN, SKINNY, "Repairing the NTR binaries... Done.");
+    updateUI();
+    return (ret);
 }
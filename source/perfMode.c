@@ -0,0 +1,81 @@
+#include "main.h"
+
+// New 3DS clock and L2 cache control for the CPU bound phases (texture
+// tiling, binary patching, Home Menu scan). On Old 3DS nothing is sent,
+// the time is still accounted for.
+
+#ifndef APP_L2_CACHE
+#define APP_L2_CACHE    1   // ENABLE_L2_CACHE of the Makefile
+#endif
+
+// PTMSYSM_ConfigureNew3DSCPU bits
+#define CPU_CLOCK_804MHZ    BIT(0)
+#define CPU_L2_CACHE        BIT(1)
+
+static const char   *perfModeNames[PERFMODE_COUNT] = { "268MHz", "804MHz" };
+
+static struct
+{
+    perfMode_t  current;
+    perfMode_t  initial;
+    bool        isNew3DS;
+    u64         since;
+    u64         ticks[PERFMODE_COUNT];
+}               perf;
+
+void        perfModeInit(void)
+{
+    // The exheader starts the app at 268MHz, with L2 if ENABLE_L2_CACHE is
+    // set. There's no getter, PERFMODE_NORMAL hands back that state.
+    APT_CheckNew3DS(&perf.isNew3DS);
+    perf.initial = PERFMODE_NORMAL;
+    perf.current = PERFMODE_NORMAL;
+    perf.since = svcGetSystemTick();
+    memset(perf.ticks, 0, sizeof(perf.ticks));
+}
+
+// Not osSetSpeedupEnable: disabling it also turns L2 off, which the
+// exheader may have given to the app
+static void configureCpu(perfMode_t mode)
+{
+    u8      config;
+
+    if (!perf.isNew3DS || R_FAILED(ptmSysmInit()))
+        return;
+    config = mode == PERFMODE_BOOST ? CPU_CLOCK_804MHZ | CPU_L2_CACHE : 0;
+    if (APP_L2_CACHE)
+        config |= CPU_L2_CACHE;
+    PTMSYSM_ConfigureNew3DSCPU(config);
+    ptmSysmExit();
+}
+
+perfMode_t  perfModeSet(perfMode_t mode)
+{
+    perfMode_t  previous = perf.current;
+    u64         tick;
+
+    if (mode == previous)
+        return (previous);
+    tick = svcGetSystemTick();
+    perf.ticks[previous] += tick - perf.since;
+    perf.since = tick;
+    perf.current = mode;
+    configureCpu(mode);
+    return (previous);
+}
+
+void        perfModeRestore(void)
+{
+    perfModeSet(perf.initial);
+}
+
+void        perfModeStats(char *dst, u32 size)
+{
+    u64     ticks[PERFMODE_COUNT];
+
+    memcpy(ticks, perf.ticks, sizeof(ticks));
+    ticks[perf.current] += svcGetSystemTick() - perf.since;
+    snprintf(dst, size, "%s %.1fs %s %.1fs",
+        perfModeNames[PERFMODE_NORMAL], ticks[PERFMODE_NORMAL] / (float)SYSCLOCK_ARM11,
+        perfModeNames[PERFMODE_BOOST], ticks[PERFMODE_BOOST] / (float)SYSCLOCK_ARM11);
+}
@@ -0,0 +1,213 @@
+#include "scanner.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PROLOGUE_INDEX_MIN  256
+
+static inline u64   load64(const u8 *p)
+{
+    u64     v;
+
+    memcpy(&v, p, sizeof(v));
+    return (v);
+}
+
+static void indexPrologue(prologueIndex_t *index, u32 pos)
+{
+    u32     *offsets;
+    u32     capacity;
+
+    if (index->count == index->capacity)
+    {
+        capacity = index->capacity ? index->capacity * 2 : PROLOGUE_INDEX_MIN;
+        offsets = (u32 *)realloc(index->offsets, capacity * sizeof(u32));
+        if (!offsets)
+        {
+            index->valid = false;
+            return;
+        }
+        index->offsets = offsets;
+        index->capacity = capacity;
+    }
+    index->offsets[index->count++] = pos;
+}
+
+// Fallback when the index is missing: walk back word by word
+static bool walkBackPrologue(const u8 *base, u32 pos, u32 window, u32 match, u32 *prologue)
+{
+    u32     term;
+    u32     word;
+
+    pos &= ~3;
+    term = pos > window ? pos - window : 0;
+    while (1)
+    {
+        word = *(const u32 *)(base + pos);
+        if ((word >> 16) == 0xe92d && (!match || word == match))
+        {
+            *prologue = pos;
+            return (true);
+        }
+        if (pos < term + 4)
+            break;
+        pos -= 4;
+    }
+    return (false);
+}
+
+void    scanSignatures(const u8 *base, u32 size, signature_t *sigs, u32 count, bool countAll)
+{
+    scanSignaturesIndexed(base, size, sigs, count, countAll, NULL);
+}
+
+void    scanSignaturesIndexed(const u8 *base, u32 size, signature_t *sigs, u32 count,
+                              bool countAll, prologueIndex_t *index)
+{
+    u64         heads[SCAN_MAX_SIGNATURES];
+    u64         masks[SCAN_MAX_SIGNATURES];
+    u32         last[SCAN_MAX_SIGNATURES];
+    u32         hi;
+    u32         pos;
+    u32         i;
+    u32         remaining;
+    u64         cur;
+    signature_t *sig;
+
+    if (count > SCAN_MAX_SIGNATURES)
+        count = SCAN_MAX_SIGNATURES;
+    size &= ~3;
+    hi = 0;
+    remaining = 0;
+    for (i = 0; i < count; i++)
+    {
+        sig = &sigs[i];
+        sig->offset = 0;
+        sig->hits = 0;
+        last[i] = 0;
+        masks[i] = 0;
+        heads[i] = 0;
+        if (!sig->pattern || !sig->count)
+            continue;
+
+        // Last offset at which the whole pattern still fits in the buffer
+        if (sig->count * 4 > size)
+            continue;
+        last[i] = size - sig->count * 4;
+
+        heads[i] = sig->pattern[0];
+        masks[i] = 0xFFFFFFFFULL;
+        if (sig->count > 1)
+        {
+            heads[i] |= (u64)sig->pattern[1] << 32;
+            masks[i] = ~0ULL;
+        }
+        if (last[i] + 4 > hi) hi = last[i] + 4;
+        remaining++;
+    }
+
+    if (index)
+    {
+        index->count = 0;
+        index->valid = true;
+    }
+
+    for (pos = 0; pos < hi && remaining; pos += 4)
+    {
+        // The last word of the buffer has no successor to load
+        if (pos + 8 <= size)
+            cur = load64(base + pos);
+        else
+            cur = *(const u32 *)(base + pos);
+
+        if (index && ((u32)cur >> 16) == 0xe92d && index->valid)
+            indexPrologue(index, pos);
+
+        for (i = 0; i < count; i++)
+        {
+            if (!masks[i] || (cur & masks[i]) != heads[i])
+                continue;
+            sig = &sigs[i];
+            if (pos > last[i])
+                continue;
+            if (sig->hits && !countAll)
+                continue;
+            if (sig->count > 2 && memcmp(base + pos + 8, sig->pattern + 2, (sig->count - 2) * 4))
+                continue;
+            if (!sig->hits++)
+            {
+                sig->offset = pos;
+                if (!countAll)
+                    remaining--;
+            }
+        }
+    }
+    if (index)
+        index->end = pos;
+}
+
+bool    prologueLookup(const prologueIndex_t *index, const u8 *base, u32 pos, u32 window,
+                       u32 match, u32 *prologue)
+{
+    u32     lo;
+    u32     hi;
+    u32     mid;
+
+    if (!index->valid || pos >= index->end)
+        return (walkBackPrologue(base, pos, window, match, prologue));
+
+    // Upper bound: first prologue past pos
+    lo = 0;
+    hi = index->count;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (index->offsets[mid] <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    while (lo-- > 0 && pos - index->offsets[lo] <= window)
+    {
+        if (!match || *(const u32 *)(base + index->offsets[lo]) == match)
+        {
+            *prologue = index->offsets[lo];
+            return (true);
+        }
+    }
+    return (false);
+}
+
+void    prologueIndexFree(prologueIndex_t *index)
+{
+    free(index->offsets);
+    memset(index, 0, sizeof(*index));
+}
+
+#define ALPHABET_LEN 256
+
+// Quick Search algorithm, adapted from
+// http://igm.univ-mlv.fr/~lecroq/string/node19.html#SECTION00190
+u32     memfind(u8 *startPos, u32 size, const void *pattern, u32 patternSize)
+{
+    u32     i;
+    u32     j;
+    u32     table[ALPHABET_LEN];
+
+    const u8 *patternc = (const u8 *)pattern;
+
+    // Preprocessing
+    for (i = 0; i < ALPHABET_LEN; ++i)
+        table[i] = patternSize + 1;
+    for (i = 0; i < patternSize; ++i)
+        table[patternc[i]] = patternSize - i;
+
+    // Searching
+    j = 0;
+    while (j <= size - patternSize)
+    {
+        if (memcmp(patternc, startPos + j, patternSize) == 0)
+            return (j);
+        j += table[startPos[j + patternSize]];
+    }
+    return (0);
+}
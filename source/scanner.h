@@ -0,0 +1,64 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __3DS__
+#include <3ds/types.h>
+#else
+typedef uint8_t   u8;
+typedef uint16_t  u16;
+typedef uint32_t  u32;
+typedef uint64_t  u64;
+#endif
+
+/*
+** Word aligned multi-pattern scanner: every signature is looked up in a
+** single forward pass over the buffer, comparing the first two words of
+** each pattern with one 64-bit compare per step.
+*/
+
+#define SCAN_MAX_SIGNATURES     16
+
+typedef struct  signature_s
+{
+    const u32   *pattern;
+    u32         count;      // pattern length, in words
+    u32         offset;     // out: offset of the first match
+    u32         hits;       // out: number of matches
+}               signature_t;
+
+// Sorted offsets of every STMFD SP!, {...} seen by the scan
+typedef struct  prologueIndex_s
+{
+    u32         *offsets;
+    u32         count;
+    u32         capacity;
+    u32         end;        // prologues past this offset weren't indexed
+    bool        valid;      // false if the index couldn't be allocated
+}               prologueIndex_t;
+
+/*
+** Fill offset and hits of each signature. Unless countAll is set, the scan
+** stops as soon as every signature was found once.
+*/
+void    scanSignatures(const u8 *base, u32 size, signature_t *sigs, u32 count, bool countAll);
+
+/*
+** Same scan, also recording the function prologues met on the way so the
+** hits can be resolved to their function without walking back.
+*/
+void    scanSignaturesIndexed(const u8 *base, u32 size, signature_t *sigs, u32 count,
+                              bool countAll, prologueIndex_t *index);
+
+/*
+** Nearest prologue at or before pos, at most window bytes back. If match
+** isn't 0, only prologues with that exact instruction are considered.
+*/
+bool    prologueLookup(const prologueIndex_t *index, const u8 *base, u32 pos, u32 window,
+                       u32 match, u32 *prologue);
+void    prologueIndexFree(prologueIndex_t *index);
+u32     memfind(u8 *startPos, u32 size, const void *pattern, u32 patternSize);
+
+#endif
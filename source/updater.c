@@ -416,6 +416,11 @@ static bool checkUpdate(void)
     return (false);
 }
 
+static bool updaterFrame(void *arg)
+{
+    return (!userOk && !((hidKeysDown() | hidKeysHeld()) & KEY_B));
+}
+
 bool launchUpdater(void)
 {
     bool update;
@@ -437,12 +442,7 @@ bool launchUpdater(void)
     if (update)
     {
         okButton->show(okButton);
-        while (!userOk)
-        {
-            updateUI();
-            if ((hidKeysDown() | hidKeysHeld()) & KEY_B)
-                break;
-        }
+        runUILoop(60, updaterFrame, NULL);
     }
     exitUpdater();
 error:
@@ -0,0 +1,165 @@
+/*
+** Runs the Home Menu signatures of analyseHomeMenu() over a set of .text
+** dumps (pidf.dmp from NTR) and reports the resolved addresses, how many
+** times each signature matched and how long the scan took.
+**
+** usage: hmscan [-b base] <dump or directory>...
+*/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "homeMenuScan.h"
+
+static u32  g_base = HOMEMENU_TEXT_BASE;
+static int  g_failed = 0;
+
+static double   elapsedUs(const struct timespec *start, const struct timespec *end)
+{
+    return ((end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3);
+}
+
+// Print an address followed by a marker when its signature isn't unique
+static void printAddr(const char *name, u32 addr, u32 hits)
+{
+    printf("  %-16s %08x  %u hit%s%s\n", name, addr, hits, hits == 1 ? "" : "s",
+           !addr ? "  MISSING" : (hits > 1 ? "  NOT UNIQUE" : ""));
+    if (!addr)
+        g_failed = 1;
+}
+
+static void scanFile(const char *path)
+{
+    FILE            *file;
+    u8              *text;
+    long            size;
+    homeMenuScan_t  scan;
+    homeMenuScan_t  all;
+    struct timespec t0;
+    struct timespec t1;
+    double          best;
+    double          bestAll;
+    int             run;
+
+    file = fopen(path, "rb");
+    if (!file)
+    {
+        perror(path);
+        g_failed = 1;
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+    text = (u8 *)malloc(size + 4);
+    if (!text || fread(text, size, 1, file) != 1)
+    {
+        fprintf(stderr, "%s: read error\n", path);
+        fclose(file);
+        free(text);
+        g_failed = 1;
+        return;
+    }
+    fclose(file);
+
+    // The scan as done on the console, then a full one to count the matches.
+    // Best of a few runs, the first one mostly measures page faults.
+    best = bestAll = 0;
+    for (run = 0; run < 5; run++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        homeMenuScan(text, size, g_base, &scan, false);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (!run || elapsedUs(&t0, &t1) < best)
+            best = elapsedUs(&t0, &t1);
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        homeMenuScan(text, size, g_base, &all, true);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (!run || elapsedUs(&t0, &t1) < bestAll)
+            bestAll = elapsedUs(&t0, &t1);
+    }
+
+    printf("%s (%ld bytes)\n", path, size);
+    printAddr("HomeFSRead", scan.fsReadAddr, all.hits[HMSIG_FS_READ]);
+    printAddr("HomeFSUHandle", scan.fsUHandleAddr, all.hits[HMSIG_FS_HANDLE]);
+    printAddr("HomeCardUpdate", scan.cardUpdateInitAddr, all.hits[HMSIG_CARD_UPDATE]);
+    printAddr("HomeAptStart", scan.aptStartAppletAddr, all.hits[HMSIG_START_APPLET]);
+    printAddr("HomeMenuInject", scan.menuInjectAddr, scan.swapBufferSig ? all.hits[scan.swapBufferSig] : 0);
+    if (scan.menuInjectAddr)
+        printf("  %-16s %s\n", "", homeMenuSigNames[scan.swapBufferSig]);
+    printf("  scan: %.1f us, full scan: %.1f us\n", best, bestAll);
+    free(text);
+}
+
+static int  compareNames(const void *a, const void *b)
+{
+    return (strcmp(*(char * const *)a, *(char * const *)b));
+}
+
+static void scanPath(const char *path)
+{
+    DIR             *dir;
+    struct dirent   *entry;
+    struct stat     st;
+    char            **names;
+    char            file[0x400];
+    int             count;
+    int             i;
+
+    if (stat(path, &st) || !S_ISDIR(st.st_mode))
+    {
+        scanFile(path);
+        return;
+    }
+    dir = opendir(path);
+    if (!dir)
+    {
+        perror(path);
+        g_failed = 1;
+        return;
+    }
+
+    // Recurse in name order so that runs can be diffed
+    names = NULL;
+    count = 0;
+    while ((entry = readdir(dir)))
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+        names = (char **)realloc(names, (count + 1) * sizeof(char *));
+        names[count++] = strdup(entry->d_name);
+    }
+    closedir(dir);
+    qsort(names, count, sizeof(char *), compareNames);
+    for (i = 0; i < count; i++)
+    {
+        snprintf(file, sizeof(file), "%s/%s", path, names[i]);
+        if (stat(file, &st) == 0 && (S_ISDIR(st.st_mode) || strstr(names[i], ".dmp")))
+            scanPath(file);
+        free(names[i]);
+    }
+    free(names);
+}
+
+int     main(int argc, char **argv)
+{
+    int     i;
+
+    i = 1;
+    if (argc > 2 && !strcmp(argv[1], "-b"))
+    {
+        g_base = strtoul(argv[2], NULL, 16);
+        i = 3;
+    }
+    if (i >= argc)
+    {
+        fprintf(stderr, "usage: %s [-b base] <dump or directory>...\n", argv[0]);
+        return (2);
+    }
+    for (; i < argc; i++)
+        scanPath(argv[i]);
+    return (g_failed);
+}
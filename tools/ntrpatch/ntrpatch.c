@@ -0,0 +1,175 @@
+/*
+** Offline version of loadAndPatch(): produces the patched ntr*.bin files
+** for one or more SD card roots, byte-identical to what the app writes on
+** its first launch.
+**
+** usage: ntrpatch [-j jobs] <romfs dir> <binaries path> <plugin path> <sd root>...
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ntrPatch.h"
+#include "jobs.h"
+
+#define PATH_SIZE   NTRPATCH_PATH_SIZE
+
+typedef struct  patchJob_s
+{
+    ntrPatch_t  patch;
+    int         error;
+    job_t       job;
+}               patchJob_t;
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-j jobs] <romfs dir> <binaries path> <plugin path> <sd root>...\n", name);
+    exit(2);
+}
+
+// Same normalisation as checkPath(): leading "/" (sdmc: is optional) and trailing '/'
+static void normalizePath(char *dst, const char *src)
+{
+    size_t  len;
+
+    if (!strncmp("sdmc:", src, 5)) src += 5;
+    snprintf(dst, PATH_SIZE - 1, "%s%s", *src == '/' ? "" : "/", src);
+    len = strlen(dst);
+    if (dst[len - 1] != '/')
+        strcpy(dst + len, "/");
+}
+
+static int  makeDirs(const char *path)
+{
+    char    tmp[PATH_SIZE];
+    char    *p;
+
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (p = tmp + 1; *p; p++)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) && errno != EEXIST)
+            return (-1);
+        *p = '/';
+    }
+    return (0);
+}
+
+static void runPatchJob(void *arg, volatile u32 *progress)
+{
+    patchJob_t  *pj = (patchJob_t *)arg;
+
+    ntrPatchRun(&pj->patch, progress);
+}
+
+int     main(int argc, char **argv)
+{
+    char        inDir[PATH_SIZE];
+    char        binPath[PATH_SIZE];
+    char        plgPath[PATH_SIZE];
+    char        outDir[PATH_SIZE];
+    char        *root;
+    patchJob_t  *jobs;
+    int         workers;
+    int         rootCount;
+    int         versionCount;
+    int         count;
+    int         ret;
+    int         opt;
+    int         i;
+
+    workers = JOBS_MAX_WORKERS;
+    while ((opt = getopt(argc, argv, "j:")) != -1)
+    {
+        if (opt != 'j')
+            usage(argv[0]);
+        workers = atoi(optarg);
+    }
+    if (argc - optind < 4)
+        usage(argv[0]);
+
+    snprintf(inDir, sizeof(inDir) - 1, "%s", argv[optind]);
+    if (inDir[strlen(inDir) - 1] != '/')
+        strcat(inDir, "/");
+    normalizePath(binPath, argv[optind + 1]);
+    normalizePath(plgPath, argv[optind + 2]);
+    rootCount = argc - optind - 3;
+    versionCount = SELECT_V36HR_MAX - SELECT_V36;
+    count = rootCount * versionCount;
+
+    jobs = (patchJob_t *)calloc(count, sizeof(patchJob_t));
+    if (!jobs)
+    {
+        fprintf(stderr, "out of memory\n");
+        return (1);
+    }
+    jobsInit(workers);
+
+    // Read every input and queue the patch, the workers run while we read
+    for (i = 0; i < count; i++)
+    {
+        patchJob_t  *pj = &jobs[i];
+
+        root = argv[optind + 3 + i / versionCount];
+        ret = snprintf(outDir, sizeof(outDir), "%s%s", root, binPath);
+        if (ret < 0 || ret >= (int)sizeof(outDir))
+        {
+            fprintf(stderr, "%s: path too long\n", root);
+            pj->error = 1;
+            continue;
+        }
+        if (root[strlen(root) - 1] == '/')
+            root[strlen(root) - 1] = '\0';
+        if (makeDirs(outDir))
+        {
+            fprintf(stderr, "%s: cannot create directory: %s\n", outDir, strerror(errno));
+            pj->error = 1;
+            continue;
+        }
+        if (!ntrPatchInit(&pj->patch, SELECT_V36 + i % versionCount, inDir, root, binPath, plgPath, true))
+        {
+            fprintf(stderr, "%s: path too long\n", root);
+            pj->error = 1;
+            continue;
+        }
+        if (ntrPatchLoad(&pj->patch) != NTRPATCH_OK)
+        {
+            fprintf(stderr, "%s: cannot read input\n", pj->patch.inPath);
+            pj->error = 1;
+            continue;
+        }
+        if (!pj->patch.upToDate)
+            jobSubmit(&pj->job, runPatchJob, pj);
+    }
+
+    ret = 0;
+    for (i = 0; i < count; i++)
+    {
+        patchJob_t  *pj = &jobs[i];
+
+        if (pj->patch.mem)
+        {
+            jobWait(&pj->job);
+            if (pj->patch.missingXref >= 0)
+                fprintf(stderr, "%s: pointer for \"%s\" is missing\n", pj->patch.inPath,
+                        ntrPatchOriginalPath[pj->patch.missingXref]);
+            if (ntrPatchSave(&pj->patch) != NTRPATCH_OK)
+            {
+                fprintf(stderr, "%s: write error\n", pj->patch.outPath);
+                pj->error = 1;
+            }
+            ntrPatchFree(&pj->patch);
+        }
+        if (!pj->error)
+            printf("%s%s\n", pj->patch.outPath, pj->patch.upToDate ? " (up to date)" : "");
+        ret |= pj->error;
+    }
+    jobsExit();
+    free(jobs);
+    return (ret);
+}
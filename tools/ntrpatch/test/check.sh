@@ -0,0 +1,39 @@
+#!/bin/sh
+# Golden output check: patch test/input.bin as every version and compare the
+# outputs with test/expected. input.bin is a 0x200 byte synthetic binary with
+# the libctru DMAState LDR at 0x10, the nine path xrefs at 0x20 and the
+# original path strings from 0x80, one every 0x20 bytes.
+
+cd "$(dirname "$0")" || exit 1
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+OUT="$TMP/out/luma/plugins/ntr"
+FAIL=0
+
+mkdir -p "$TMP/romfs"
+while read -r name crc; do
+    cp input.bin "$TMP/romfs/$name"
+done < expected.crc
+
+../ntrpatch -j 2 "$TMP/romfs" /luma/plugins/ntr/ /luma/plugins/ "$TMP/out" > /dev/null || exit 1
+
+# crc32 of each output, taken from the gzip trailer
+while read -r name crc; do
+    got=$(gzip -c "$OUT/$name" | tail -c 8 | od -An -tx4 -N4 | tr -d ' ')
+    if [ "$got" != "$crc" ]; then
+        echo "$name: crc $got, expected $crc"
+        FAIL=1
+    fi
+    if [ ! -f "$OUT/$name.stamp" ]; then
+        echo "$name: no stamp"
+        FAIL=1
+    fi
+done < expected.crc
+
+# Byte for byte on the version that also gets the DMAState fix
+if ! cmp "$OUT/ntr.bin" expected/ntr.bin; then
+    FAIL=1
+fi
+
+[ "$FAIL" = 0 ] && echo "ntrpatch: golden outputs match"
+exit $FAIL
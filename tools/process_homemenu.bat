@@ -1,4 +0,0 @@
-del result.txt
-locate_homemenu.py pidf.dmp > result.txt
-
-pause
\ No newline at end of file
@@ -0,0 +1,288 @@
+/*
+** Host benchmark of the first launch setup: runs configInit(), the
+** setFiles() sequence, repairBinaries() and configExit() from the app
+** sources against a directory standing in for the SD card, through the
+** instrumented shim.
+**
+** usage: setupbench [-l latency_us] <romfs dir> <sd dir>
+**        setupbench [-l latency_us] -c <sd dir>
+**
+** The first pass is a real first launch when <sd dir> is empty, the
+** second one is a regular start and the last one runs the setup again
+** over its own outputs.
+** -c checks and times copy_file() instead, on sizes with and without a
+** partial tail.
+*/
+
+#define SHIM_NO_REDIRECT
+#include "shim.h"
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "main.h"
+#include "config.h"
+
+extern bootNtrConfig_t  *bnConfig;
+
+bool    saveConfig(void);
+
+char                    *g_primary_error;
+char                    *g_secondary_error;
+char                    *g_third_error;
+appInfoObject_t         *appStatus;
+appInfoObject_t         *appTop;
+appInfoObject_t         *appBottom;
+
+static Handle           g_fsuHandle;
+static Result           g_setupResult;
+
+/*
+** App functions the setup path calls, the UI is dropped
+*/
+
+void    newAppInfoEntry(appInfoObject_t *object, u32 color, u32 flags, char *text, ...)
+{
+    va_list args;
+
+    (void)color;
+    (void)flags;
+    if (object != appTop || !getenv("SETUPBENCH_VERBOSE"))
+        return;
+    va_start(args, text);
+    vfprintf(stderr, text, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+void    removeAppInfoEntry(appInfoObject_t *object) { (void)object; }
+void    clearAppInfo(appInfoObject_t *object, bool updateScreen) { (void)object; (void)updateScreen; }
+int     updateUI(void) { return (0); }
+perfMode_t  perfModeSet(perfMode_t mode) { return (mode); }
+void    wait(int seconds) { (void)seconds; }
+Handle  *fsGetSessionHandle(void) { return (&g_fsuHandle); }
+bool    envIsHomebrew(void) { return (false); }
+
+Result  APT_CheckNew3DS(bool *out)
+{
+    *out = true;
+    return (0);
+}
+
+// Same as common_functions.c
+void    strJoin(char *dst, const char *s1, const char *s2)
+{
+    if (!dst || !s1 || !s2) return;
+
+    while (*s1)
+        *dst++ = *s1++;
+    while (*s2)
+        *dst++ = *s2++;
+    *dst = '\0';
+}
+
+void    strInsert(char *dst, char *src, int index)
+{
+    char    *bak;
+    int     srcSize;
+
+    if (!dst || !src) return;
+
+    bak = strdup(dst + index);
+    strcpy(dst + index, src);
+    srcSize = strlen(src);
+    strcpy(dst + srcSize, bak);
+    free(bak);
+}
+
+// defaultSettings() followed by setFiles(), without the menus
+int     firstLaunch(void)
+{
+    version_t   versions[SELECT_V36HR_MAX - SELECT_V36];
+    const int   count = SELECT_V36HR_MAX - SELECT_V36;
+    int         i;
+
+    strcpy(bnConfig->config->binariesPath, "sdmc:/3ds/BootNTRSelector/");
+    strJoin(bnConfig->config->pluginPath, "sdmc:/", "plugin/");
+
+    if (!fileExists(bnConfig->config->binariesPath + 5))
+        g_setupResult |= createDir(bnConfig->config->binariesPath + 5);
+    if (!fileExists(bnConfig->config->pluginPath + 5))
+        g_setupResult |= createDir(bnConfig->config->pluginPath + 5);
+
+    for (i = 0; i < count; i++)
+        versions[i] = SELECT_V36 + i;
+    g_setupResult |= loadAndPatchVersions(versions, count, NULL, NULL);
+    return (0);
+}
+
+/*
+** Benchmark
+*/
+
+static double  now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-l latency_us] <romfs dir> <sd dir>\n", name);
+    fprintf(stderr, "       %s [-l latency_us] -c <sd dir>\n", name);
+    exit(2);
+}
+
+static void report(const char *name, double seconds)
+{
+    printf("%-13s %9.2f %6lu %6lu %6lu %6lu %9.1f %9.1f %9.1f %8.1f\n", name,
+           seconds * 1000.0, shimStats.opens, shimStats.reads, shimStats.writes,
+           shimStats.metaOps, shimStats.bytesRead / 1024.0, shimStats.bytesWritten / 1024.0,
+           shimStats.heapPeak / 1024.0, shimStats.injectedSec * 1000.0);
+}
+
+// Same sequence as main()
+static int  runPass(const char *name, bool again)
+{
+    double  start;
+
+    g_setupResult = 0;
+    shimResetStats();
+    start = now();
+    if (configInit(0) || repairBinaries())
+        g_setupResult = RESULT_ERROR;
+    else if (again)
+    {
+        firstLaunch();
+        if (!saveConfig())
+            g_setupResult = RESULT_ERROR;
+    }
+    if (bnConfig && bnConfig->config)
+        configExit();
+    report(name, now() - start);
+    return (g_setupResult != 0);
+}
+
+static const u32   copySizes[] =
+{
+    0, 1, 15, 16, 17, 0x1000, 0x1FFFF, 0x20000, 0x20001, 0x400000, 0x400000 + 13
+};
+
+static bool writePattern(const char *path, u32 size)
+{
+    FILE    *file;
+    u32     i;
+
+    file = fopen(path, "wb");
+    if (!file)
+        return (false);
+    for (i = 0; i < size; i++)
+        fputc((i * 7 + i / 251) & 0xFF, file);
+    return (!fclose(file));
+}
+
+static bool checkPattern(const char *path, u32 size)
+{
+    FILE    *file;
+    u32     i;
+    int     c;
+
+    file = fopen(path, "rb");
+    if (!file)
+        return (false);
+    for (i = 0; i < size; i++)
+        if ((c = fgetc(file)) != (int)((i * 7 + i / 251) & 0xFF))
+            break;
+    c = i == size && fgetc(file) == EOF;
+    fclose(file);
+    return (c);
+}
+
+static int  runCopyBench(const char *sdRoot)
+{
+    char    src[0x400];
+    char    dst[0x400];
+    double  start;
+    double  seconds;
+    bool    ok;
+    int     ret;
+    u32     i;
+
+    snprintf(src, sizeof(src), "%s/setupbench.src", sdRoot);
+    snprintf(dst, sizeof(dst), "%s/setupbench.dst", sdRoot);
+    printf("%-10s %9s %9s %6s %6s %s\n", "size", "wall ms", "MiB/s", "reads", "writes", "result");
+    ret = 0;
+    for (i = 0; i < sizeof(copySizes) / sizeof(copySizes[0]); i++)
+    {
+        if (!writePattern(src, copySizes[i]))
+        {
+            fprintf(stderr, "%s: cannot write\n", src);
+            return (1);
+        }
+        shimResetStats();
+        start = now();
+        ok = !copy_file("sdmc:/setupbench.src", "sdmc:/setupbench.dst");
+        seconds = now() - start;
+        ok = ok && checkPattern(dst, copySizes[i]);
+        printf("%-10u %9.2f %9.1f %6lu %6lu %s\n", copySizes[i], seconds * 1000.0,
+               copySizes[i] / 1048576.0 / seconds, shimStats.reads, shimStats.writes, ok ? "ok" : "FAIL");
+        ret |= !ok;
+    }
+    unlink(src);
+    unlink(dst);
+    return (ret);
+}
+
+int     main(int argc, char **argv)
+{
+    struct rusage   rusage;
+    struct stat     st;
+    char            config[0x400];
+    const char      *sdRoot;
+    unsigned        latencyUs;
+    bool            copyBench;
+    int             ret;
+    int             opt;
+
+    latencyUs = 0;
+    copyBench = false;
+    while ((opt = getopt(argc, argv, "l:c")) != -1)
+    {
+        if (opt == 'l')
+            latencyUs = strtoul(optarg, NULL, 0);
+        else if (opt == 'c')
+            copyBench = true;
+        else
+            usage(argv[0]);
+    }
+    if (argc - optind != (copyBench ? 1 : 2))
+        usage(argv[0]);
+    sdRoot = argv[argc - 1];
+    if (stat(sdRoot, &st) || !S_ISDIR(st.st_mode))
+    {
+        fprintf(stderr, "%s: not a directory\n", sdRoot);
+        return (2);
+    }
+
+    shimSetup(sdRoot, copyBench ? "." : argv[optind], latencyUs);
+    printf("latency per I/O call: %u us\n", latencyUs);
+    if (copyBench)
+        return (runCopyBench(sdRoot));
+
+    snprintf(config, sizeof(config), "%s/3ds/BootNTRSelector/config", sdRoot);
+    if (!access(config, F_OK))
+        fprintf(stderr, "warning: %s exists, the first pass is not a first launch\n", config);
+    printf("%-13s %9s %6s %6s %6s %6s %9s %9s %9s %8s\n", "pass", "wall ms", "opens", "reads",
+           "writes", "meta", "read KiB", "wrote KiB", "heap KiB", "inj ms");
+    ret = runPass("first launch", false);
+    ret |= runPass("startup", false);
+    ret |= runPass("setup again", true);
+
+    getrusage(RUSAGE_SELF, &rusage);
+    printf("max rss: %ld KiB\n", rusage.ru_maxrss);
+    if (ret)
+        fprintf(stderr, "setup failed, run with SETUPBENCH_VERBOSE=1 for the app messages\n");
+    return (ret);
+}
@@ -0,0 +1,288 @@
+#define SHIM_NO_REDIRECT
+#include "shim.h"
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#define SHIM_PATH_SIZE  0x400
+#define HEAP_HEADER     16  // keeps the returned blocks 16 bytes aligned
+
+shimStats_t         shimStats;
+
+static const char   *g_sdRoot = ".";
+static const char   *g_romfsRoot = ".";
+static unsigned     g_latencyUs;
+
+void    shimSetup(const char *sdRoot, const char *romfsRoot, unsigned latencyUs)
+{
+    g_sdRoot = sdRoot;
+    g_romfsRoot = romfsRoot;
+    g_latencyUs = latencyUs;
+}
+
+void    shimResetStats(void)
+{
+    size_t  inUse = shimStats.heapInUse;
+
+    memset(&shimStats, 0, sizeof(shimStats));
+    shimStats.heapInUse = inUse;
+    shimStats.heapPeak = inUse;
+}
+
+// Every I/O call pays the injected latency once, like an SD card command
+static void injectLatency(void)
+{
+    struct timespec ts;
+
+    if (!g_latencyUs)
+        return;
+    ts.tv_sec = g_latencyUs / 1000000;
+    ts.tv_nsec = (g_latencyUs % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+    shimStats.injectedSec += g_latencyUs / 1e6;
+}
+
+static const char   *mapPath(const char *path, char *out)
+{
+    const char  *root = NULL;
+
+    if (!strncmp(path, "romfs:", 6))
+    {
+        root = g_romfsRoot;
+        path += 6;
+    }
+    else if (!strncmp(path, "sdmc:", 5))
+    {
+        root = g_sdRoot;
+        path += 5;
+    }
+    else if (*path == '/')
+        root = g_sdRoot;
+    if (!root)
+        return (path);
+    snprintf(out, SHIM_PATH_SIZE, "%s%s%s", root, *path == '/' ? "" : "/", path);
+    return (out);
+}
+
+FILE    *shimFopen(const char *path, const char *mode)
+{
+    char    buf[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.opens++;
+    return (fopen(mapPath(path, buf), mode));
+}
+
+size_t  shimFread(void *ptr, size_t size, size_t count, FILE *file)
+{
+    size_t  ret;
+
+    injectLatency();
+    ret = fread(ptr, size, count, file);
+    shimStats.reads++;
+    shimStats.bytesRead += ret * size;
+    return (ret);
+}
+
+size_t  shimFwrite(const void *ptr, size_t size, size_t count, FILE *file)
+{
+    size_t  ret;
+
+    injectLatency();
+    ret = fwrite(ptr, size, count, file);
+    shimStats.writes++;
+    shimStats.bytesWritten += ret * size;
+    return (ret);
+}
+
+int     shimFclose(FILE *file)
+{
+    injectLatency();
+    return (fclose(file));
+}
+
+int     shimFseek(FILE *file, long offset, int whence)
+{
+    injectLatency();
+    shimStats.metaOps++;
+    return (fseek(file, offset, whence));
+}
+
+int     shimOpen(const char *path, int flags, ...)
+{
+    char    buf[SHIM_PATH_SIZE];
+    mode_t  mode = 0;
+    va_list args;
+
+    if (flags & O_CREAT)
+    {
+        va_start(args, flags);
+        mode = va_arg(args, int);
+        va_end(args);
+    }
+    injectLatency();
+    shimStats.opens++;
+    return (open(mapPath(path, buf), flags, mode));
+}
+
+ssize_t shimRead(int fd, void *buffer, size_t size)
+{
+    ssize_t ret;
+
+    injectLatency();
+    ret = read(fd, buffer, size);
+    shimStats.reads++;
+    if (ret > 0)
+        shimStats.bytesRead += ret;
+    return (ret);
+}
+
+ssize_t shimWrite(int fd, const void *buffer, size_t size)
+{
+    ssize_t ret;
+
+    injectLatency();
+    ret = write(fd, buffer, size);
+    shimStats.writes++;
+    if (ret > 0)
+        shimStats.bytesWritten += ret;
+    return (ret);
+}
+
+int     shimClose(int fd)
+{
+    injectLatency();
+    return (close(fd));
+}
+
+int     shimFtruncate(int fd, off_t size)
+{
+    injectLatency();
+    shimStats.metaOps++;
+    return (ftruncate(fd, size));
+}
+
+int     shimFstat(int fd, struct stat *st)
+{
+    injectLatency();
+    shimStats.metaOps++;
+    return (fstat(fd, st));
+}
+
+int     shimStat(const char *path, struct stat *st)
+{
+    char    buf[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.metaOps++;
+    return (stat(mapPath(path, buf), st));
+}
+
+int     shimAccess(const char *path, int mode)
+{
+    char    buf[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.metaOps++;
+    return (access(mapPath(path, buf), mode));
+}
+
+int     shimMkdir(const char *path, mode_t mode)
+{
+    char    buf[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.metaOps++;
+    // The app passes 777 (decimal), keep the host directories usable
+    (void)mode;
+    return (mkdir(mapPath(path, buf), 0755));
+}
+
+int     shimRemove(const char *path)
+{
+    char    buf[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.metaOps++;
+    return (remove(mapPath(path, buf)));
+}
+
+int     shimRmdir(const char *path)
+{
+    char    buf[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.metaOps++;
+    return (rmdir(mapPath(path, buf)));
+}
+
+int     shimRename(const char *from, const char *to)
+{
+    char    bufFrom[SHIM_PATH_SIZE];
+    char    bufTo[SHIM_PATH_SIZE];
+
+    injectLatency();
+    shimStats.metaOps++;
+    return (rename(mapPath(from, bufFrom), mapPath(to, bufTo)));
+}
+
+// Heap accounting: the block size is kept in front of every allocation.
+// The patch workers allocate too, hence the atomics.
+static void *trackAlloc(unsigned char *block, size_t size)
+{
+    size_t  inUse;
+    size_t  peak;
+
+    if (!block)
+        return (NULL);
+    *(size_t *)block = size;
+    __atomic_add_fetch(&shimStats.allocs, 1, __ATOMIC_RELAXED);
+    inUse = __atomic_add_fetch(&shimStats.heapInUse, size, __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&shimStats.heapPeak, __ATOMIC_RELAXED);
+    while (inUse > peak && !__atomic_compare_exchange_n(&shimStats.heapPeak, &peak, inUse,
+                                                        1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    return (block + HEAP_HEADER);
+}
+
+static void untrack(unsigned char *block)
+{
+    __atomic_sub_fetch(&shimStats.heapInUse, *(size_t *)block, __ATOMIC_RELAXED);
+}
+
+void    *shimMalloc(size_t size)
+{
+    return (trackAlloc(malloc(size + HEAP_HEADER), size));
+}
+
+void    *shimCalloc(size_t count, size_t size)
+{
+    return (trackAlloc(calloc(1, count * size + HEAP_HEADER), count * size));
+}
+
+void    *shimRealloc(void *ptr, size_t size)
+{
+    unsigned char   *block;
+    size_t          oldSize;
+
+    if (!ptr)
+        return (shimMalloc(size));
+    block = (unsigned char *)ptr - HEAP_HEADER;
+    oldSize = *(size_t *)block;
+    block = realloc(block, size + HEAP_HEADER);
+    if (!block)
+        return (NULL);
+    __atomic_sub_fetch(&shimStats.heapInUse, oldSize, __ATOMIC_RELAXED);
+    return (trackAlloc(block, size));
+}
+
+void    shimFree(void *ptr)
+{
+    unsigned char   *block;
+
+    if (!ptr)
+        return;
+    block = (unsigned char *)ptr - HEAP_HEADER;
+    untrack(block);
+    free(block);
+}
@@ -0,0 +1,83 @@
+/*
+** Instrumented POSIX shim, force-included (-include shim.h) in every
+** app source the benchmark builds. Console paths ("sdmc:/", "romfs:/",
+** absolute paths) are redirected to host directories, every call is
+** counted and can be slowed down to emulate a slow SD card.
+*/
+
+#ifndef SHIM_H
+#define SHIM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+typedef struct  shimStats_s
+{
+    unsigned long   opens;
+    unsigned long   reads;
+    unsigned long   writes;
+    unsigned long   metaOps;        // stat, access, mkdir, remove, rename...
+    unsigned long   bytesRead;
+    unsigned long   bytesWritten;
+    unsigned long   allocs;
+    size_t          heapInUse;
+    size_t          heapPeak;
+    double          injectedSec;    // time spent in the latency injection
+}               shimStats_t;
+
+extern shimStats_t  shimStats;
+
+void    shimSetup(const char *sdRoot, const char *romfsRoot, unsigned latencyUs);
+void    shimResetStats(void);
+
+FILE    *shimFopen(const char *path, const char *mode);
+size_t  shimFread(void *ptr, size_t size, size_t count, FILE *file);
+size_t  shimFwrite(const void *ptr, size_t size, size_t count, FILE *file);
+int     shimFclose(FILE *file);
+int     shimFseek(FILE *file, long offset, int whence);
+int     shimOpen(const char *path, int flags, ...);
+ssize_t shimRead(int fd, void *buffer, size_t size);
+ssize_t shimWrite(int fd, const void *buffer, size_t size);
+int     shimClose(int fd);
+int     shimFtruncate(int fd, off_t size);
+int     shimFstat(int fd, struct stat *st);
+int     shimStat(const char *path, struct stat *st);
+int     shimAccess(const char *path, int mode);
+int     shimMkdir(const char *path, mode_t mode);
+int     shimRemove(const char *path);
+int     shimRmdir(const char *path);
+int     shimRename(const char *from, const char *to);
+void    *shimMalloc(size_t size);
+void    *shimCalloc(size_t count, size_t size);
+void    *shimRealloc(void *ptr, size_t size);
+void    shimFree(void *ptr);
+
+#ifndef SHIM_NO_REDIRECT
+#define fopen(p, m)         shimFopen(p, m)
+#define fread(p, s, c, f)   shimFread(p, s, c, f)
+#define fwrite(p, s, c, f)  shimFwrite(p, s, c, f)
+#define fclose(f)           shimFclose(f)
+#define fseek(f, o, w)      shimFseek(f, o, w)
+#define open(...)           shimOpen(__VA_ARGS__)
+#define read(f, b, s)       shimRead(f, b, s)
+#define write(f, b, s)      shimWrite(f, b, s)
+#define close(f)            shimClose(f)
+#define ftruncate(f, s)     shimFtruncate(f, s)
+#define fstat(f, s)         shimFstat(f, s)
+#define stat(p, s)          shimStat(p, s)
+#define access(p, m)        shimAccess(p, m)
+#define mkdir(p, m)         shimMkdir(p, m)
+#define remove(p)           shimRemove(p)
+#define rmdir(p)            shimRmdir(p)
+#define rename(f, t)        shimRename(f, t)
+#define malloc(s)           shimMalloc(s)
+#define calloc(c, s)        shimCalloc(c, s)
+#define realloc(p, s)       shimRealloc(p, s)
+#define free(p)             shimFree(p)
+#endif
+
+#endif
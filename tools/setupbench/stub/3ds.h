@@ -0,0 +1,16 @@
+// Just enough of libctru for the setup path to build on the host
+#ifndef SETUPBENCH_3DS_H
+#define SETUPBENCH_3DS_H
+
+#include "3ds/types.h"
+#include "3ds/services/hid.h"
+
+typedef void    (*ThreadFunc)(void *);
+typedef enum { GFX_TOP, GFX_BOTTOM } gfxScreen_t;
+typedef struct { u16 px, py; } touchPosition;
+
+Result  APT_CheckNew3DS(bool *out);
+Handle  *fsGetSessionHandle(void);
+bool    envIsHomebrew(void);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SETUPBENCH_3DS_HID_H
+#define SETUPBENCH_3DS_HID_H
+
+enum { KEY_A = BIT(0), KEY_B = BIT(1), KEY_SELECT = BIT(2), KEY_START = BIT(3), KEY_X = BIT(10) };
+
+#endif
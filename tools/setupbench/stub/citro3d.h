@@ -0,0 +1,8 @@
+#ifndef SETUPBENCH_CITRO3D_H
+#define SETUPBENCH_CITRO3D_H
+
+typedef struct { void *data; u16 width, height; u32 param; u32 fmt; u32 size; } C3D_Tex;
+typedef struct { float m[16]; } C3D_Mtx;
+typedef struct C3D_RenderTarget_tag C3D_RenderTarget;
+
+#endif